@@ -0,0 +1,13 @@
+#include "AdaptiveAllocator.hpp"
+
+namespace backend
+{
+
+    RegisterAssignment AdaptiveAllocator::allocate(IrFunction *func)
+    {
+        if (countAllocatableValues(func) > coloringLimit)
+            return linearScan.allocate(func);
+        return graphColoring.allocate(func);
+    }
+
+} // namespace backend
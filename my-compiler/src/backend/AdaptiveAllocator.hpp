@@ -0,0 +1,31 @@
+#pragma once
+
+#include "RegisterAllocator.hpp"
+#include "GraphColoringAllocator.hpp"
+#include "LinearScanAllocator.hpp"
+
+namespace backend
+{
+
+    // Chooses an allocator per function. Building the interference graph is
+    // roughly quadratic in the number of simultaneously live values, so
+    // functions with more than `coloringLimit` values go to linear scan and
+    // everything else gets the better graph-coloring result.
+    class AdaptiveAllocator final : public RegisterAllocator
+    {
+    public:
+        static constexpr std::size_t kDefaultColoringLimit = 4000;
+
+        explicit AdaptiveAllocator(std::size_t coloringLimit = kDefaultColoringLimit)
+            : coloringLimit(coloringLimit) {}
+
+        std::string name() const override { return "auto"; }
+        RegisterAssignment allocate(IrFunction *func) override;
+
+    private:
+        std::size_t coloringLimit;
+        GraphColoringAllocator graphColoring;
+        LinearScanAllocator linearScan;
+    };
+
+} // namespace backend
@@ -0,0 +1,298 @@
+#include "BlockLayout.hpp"
+#include "NaturalLoops.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace backend
+{
+
+    namespace
+    {
+
+        bool isCondBranch(const MachineInstr &mi) { return mi.info().isBranch; }
+
+        bool canFallThrough(const MachineBasicBlock &bb)
+        {
+            if (bb.instrs.empty())
+                return true;
+            MOpcode op = bb.instrs.back().opcode;
+            return op != MOpcode::J && op != MOpcode::JR;
+        }
+
+        MOpcode invertBranch(MOpcode op)
+        {
+            switch (op)
+            {
+            case MOpcode::BEQ:
+                return MOpcode::BNE;
+            case MOpcode::BNE:
+                return MOpcode::BEQ;
+            case MOpcode::BLT:
+                return MOpcode::BGE;
+            case MOpcode::BGE:
+                return MOpcode::BLT;
+            case MOpcode::BGT:
+                return MOpcode::BLE;
+            case MOpcode::BLE:
+                return MOpcode::BGT;
+            case MOpcode::BEQZ:
+                return MOpcode::BNEZ;
+            case MOpcode::BNEZ:
+                return MOpcode::BEQZ;
+            case MOpcode::BLTZ:
+                return MOpcode::BGEZ;
+            case MOpcode::BGEZ:
+                return MOpcode::BLTZ;
+            case MOpcode::BGTZ:
+                return MOpcode::BLEZ;
+            case MOpcode::BLEZ:
+                return MOpcode::BGTZ;
+            default:
+                return op;
+            }
+        }
+
+        struct Cfg
+        {
+            int n = 0;
+            std::vector<std::vector<int>> succ, pred;
+            std::vector<std::vector<bool>> inLoop; // [loop][block]
+            std::vector<int> header;               // [loop]
+        };
+
+        Cfg buildCfg(MachineFunction &mf)
+        {
+            Cfg cfg;
+            cfg.n = (int)mf.blocks.size();
+            std::unordered_map<MachineBasicBlock *, int> index;
+            for (int i = 0; i < cfg.n; ++i)
+                index[mf.blocks[i].get()] = i;
+            cfg.succ.resize(cfg.n);
+            cfg.pred.resize(cfg.n);
+            for (int i = 0; i < cfg.n; ++i)
+            {
+                for (const auto &mi : mf.blocks[i]->instrs)
+                {
+                    if (!mi.info().isBranch && mi.opcode != MOpcode::J)
+                        continue;
+                    const MOperand &target = mi.operands.back();
+                    if (target.kind != MOperand::Kind::Block || !index.count(target.block))
+                        continue;
+                    int t = index[target.block];
+                    if (std::find(cfg.succ[i].begin(), cfg.succ[i].end(), t) == cfg.succ[i].end())
+                    {
+                        cfg.succ[i].push_back(t);
+                        cfg.pred[t].push_back(i);
+                    }
+                }
+            }
+
+            for (auto &loop : findNaturalLoops(cfg.succ, cfg.pred))
+            {
+                cfg.header.push_back(loop.header);
+                cfg.inLoop.push_back(std::move(loop.body));
+            }
+            return cfg;
+        }
+
+        // If `bb` ends with "b<cond> X ; j Y", returns the branch.
+        MachineInstr *exitTest(MachineBasicBlock &bb)
+        {
+            if (bb.instrs.size() < 2 || bb.instrs.back().opcode != MOpcode::J)
+                return nullptr;
+            auto &branch = *std::prev(bb.instrs.end(), 2);
+            return isCondBranch(branch) ? &branch : nullptr;
+        }
+
+        bool isJumpOnly(const MachineBasicBlock &bb)
+        {
+            return bb.instrs.size() == 1 && bb.instrs.front().opcode == MOpcode::J &&
+                   bb.instrs.front().operands.back().kind == MOperand::Kind::Block;
+        }
+
+        // Where a jump to `bb` ends up once blocks that only jump are
+        // skipped.
+        MachineBasicBlock *finalTarget(MachineBasicBlock *bb)
+        {
+            std::unordered_set<MachineBasicBlock *> seen;
+            while (isJumpOnly(*bb) && seen.insert(bb).second)
+                bb = bb->instrs.front().operands.back().block;
+            return bb;
+        }
+
+        // Points every jump and branch past blocks that only jump, then
+        // drops those blocks once nothing refers to them. Fallthroughs must
+        // already be explicit. Returns how many of the dropped jumps were
+        // not in `synthesized`.
+        int threadJumps(MachineFunction &mf, const std::unordered_set<MachineBasicBlock *> &synthesized)
+        {
+            std::unordered_set<MachineBasicBlock *> referenced;
+            for (auto &bb : mf.blocks)
+            {
+                for (auto &mi : bb->instrs)
+                {
+                    if (!mi.info().isBranch && mi.opcode != MOpcode::J)
+                        continue;
+                    MOperand &target = mi.operands.back();
+                    if (target.kind != MOperand::Kind::Block)
+                        continue;
+                    target.block = finalTarget(target.block);
+                    referenced.insert(target.block);
+                }
+            }
+            int dropped = 0;
+            auto first = std::next(mf.blocks.begin());
+            auto end = std::remove_if(first, mf.blocks.end(), [&](const std::unique_ptr<MachineBasicBlock> &bb)
+                                      {
+                                          if (!isJumpOnly(*bb) || referenced.count(bb.get()))
+                                              return false;
+                                          dropped += synthesized.count(bb.get()) == 0;
+                                          return true; });
+            mf.blocks.erase(end, mf.blocks.end());
+            return dropped;
+        }
+
+    } // namespace
+
+    int layoutBlocks(MachineFunction &mf)
+    {
+        if (mf.blocks.size() < 2)
+            return 0;
+
+        // Make every fallthrough an explicit jump so blocks can move freely.
+        // These jumps were never in the code, so removing them later does
+        // not count.
+        std::unordered_set<MachineBasicBlock *> synthesized;
+        for (size_t i = 0; i + 1 < mf.blocks.size(); ++i)
+        {
+            if (canFallThrough(*mf.blocks[i]))
+            {
+                mf.blocks[i]->append(MOpcode::J, {MOperand::label(mf.blocks[i + 1].get())});
+                synthesized.insert(mf.blocks[i].get());
+            }
+        }
+        int removed = threadJumps(mf, synthesized);
+        const int n = (int)mf.blocks.size();
+
+        Cfg cfg = buildCfg(mf);
+        std::unordered_map<MachineBasicBlock *, int> index;
+        for (int i = 0; i < n; ++i)
+            index[mf.blocks[i].get()] = i;
+
+        // Edges the header of a rotated loop must not fall through.
+        std::vector<std::pair<int, int>> rotated;
+        for (size_t l = 0; l < cfg.header.size(); ++l)
+        {
+            int h = cfg.header[l];
+            MachineInstr *branch = exitTest(*mf.blocks[h]);
+            if (!branch)
+                continue;
+            int x = index[branch->operands.back().block];
+            int y = index[mf.blocks[h]->instrs.back().operands.back().block];
+            bool xIn = cfg.inLoop[l][x], yIn = cfg.inLoop[l][y];
+            if (xIn != yIn)
+                rotated.push_back({h, xIn ? x : y});
+        }
+
+        struct Edge
+        {
+            int from, to;
+            double weight;
+        };
+        std::vector<Edge> edges;
+        for (int u = 0; u < n; ++u)
+        {
+            for (int v : cfg.succ[u])
+            {
+                if (v == 0 || std::find(rotated.begin(), rotated.end(), std::make_pair(u, v)) != rotated.end())
+                    continue;
+                int shared = 0;
+                for (auto &body : cfg.inLoop)
+                    shared += body[u] && body[v];
+                edges.push_back({u, v, std::pow(10.0, std::min(shared, 8))});
+            }
+        }
+        // Heavier edges first; among equals keep the original order, which
+        // already has most then-blocks and loop bodies right after their test.
+        std::stable_sort(edges.begin(), edges.end(), [](const Edge &a, const Edge &b)
+                         {
+                             if (a.weight != b.weight)
+                                 return a.weight > b.weight;
+                             bool aNext = a.to == a.from + 1, bNext = b.to == b.from + 1;
+                             if (aNext != bNext)
+                                 return aNext;
+                             return a.from < b.from; });
+
+        std::vector<std::vector<int>> chains(n);
+        std::vector<int> chainOf(n);
+        for (int i = 0; i < n; ++i)
+        {
+            chains[i] = {i};
+            chainOf[i] = i;
+        }
+        for (const Edge &e : edges)
+        {
+            int cu = chainOf[e.from], cv = chainOf[e.to];
+            if (cu == cv || chains[cu].back() != e.from || chains[cv].front() != e.to)
+                continue;
+            for (int b : chains[cv])
+            {
+                chains[cu].push_back(b);
+                chainOf[b] = cu;
+            }
+            chains[cv].clear();
+        }
+
+        // Entry chain first, the rest by the original position of their head.
+        std::vector<int> heads;
+        for (int c = 0; c < n; ++c)
+        {
+            if (!chains[c].empty() && c != chainOf[0])
+                heads.push_back(c);
+        }
+        std::sort(heads.begin(), heads.end(), [&](int a, int b)
+                  { return chains[a].front() < chains[b].front(); });
+        heads.insert(heads.begin(), chainOf[0]);
+        std::vector<int> order;
+        for (int c : heads)
+            order.insert(order.end(), chains[c].begin(), chains[c].end());
+
+        std::vector<std::unique_ptr<MachineBasicBlock>> placed;
+        placed.reserve(n);
+        for (int b : order)
+            placed.push_back(std::move(mf.blocks[b]));
+        mf.blocks = std::move(placed);
+
+        for (int i = 0; i + 1 < n; ++i)
+        {
+            auto &bb = *mf.blocks[i];
+            MachineBasicBlock *next = mf.blocks[i + 1].get();
+            if (bb.instrs.empty() || bb.instrs.back().opcode != MOpcode::J)
+                continue;
+            MachineInstr &jump = bb.instrs.back();
+            const bool original = synthesized.count(&bb) == 0;
+            if (jump.operands.back().block == next)
+            {
+                bb.instrs.pop_back();
+                removed += original;
+                continue;
+            }
+            MachineInstr *branch = exitTest(bb);
+            if (branch && branch->operands.back().block == next && invertBranch(branch->opcode) != branch->opcode)
+            {
+                branch->opcode = invertBranch(branch->opcode);
+                branch->operands.back() = jump.operands.back();
+                bb.instrs.pop_back();
+                removed += original;
+            }
+        }
+        return removed;
+    }
+
+} // namespace backend
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "MachineIR.hpp"
+
+namespace backend
+{
+
+    // Reorders the blocks of a function so that likely successors fall
+    // through, then drops jumps to the next block and inverts conditional
+    // branches whose taken target ends up next. The first block stays first.
+    //
+    // Blocks are merged into chains along CFG edges, inner-loop edges first.
+    // A loop header that tests the exit condition is not chained to its loop
+    // body; it is placed after the latch instead, so each iteration ends with
+    // a single conditional branch back to the body.
+    //
+    // Jumps into blocks that do nothing but jump are first sent straight to
+    // the final target, and the skipped blocks dropped.
+    //
+    // Returns the number of jumps removed, counting only jumps the code
+    // had before layout, not those made explicit for it.
+    int layoutBlocks(MachineFunction &mf);
+
+} // namespace backend
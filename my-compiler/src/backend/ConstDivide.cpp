@@ -0,0 +1,158 @@
+#include "ConstDivide.hpp"
+#include "ConstMultiply.hpp"
+#include "MarsCost.hpp"
+
+#include <cstdlib>
+
+namespace backend
+{
+
+    namespace
+    {
+
+        void append(std::vector<MachineInstr> &out, MOpcode op, std::vector<MOperand> ops)
+        {
+            out.emplace_back(op, std::move(ops));
+        }
+
+        MOperand reg(PReg r) { return MOperand::preg(r); }
+        MOperand imm(int64_t v) { return MOperand::immediate(v); }
+
+    } // namespace
+
+    SignedMagic signedMagic(int32_t d)
+    {
+        const uint32_t two31 = 0x80000000u;
+        uint32_t ad = (uint32_t)std::llabs((long long)d);
+        uint32_t t = two31 + ((uint32_t)d >> 31);
+        uint32_t anc = t - 1 - t % ad; // |nc|
+        int p = 31;
+        uint32_t q1 = two31 / anc, r1 = two31 - q1 * anc;
+        uint32_t q2 = two31 / ad, r2 = two31 - q2 * ad;
+        uint32_t delta;
+        do
+        {
+            ++p;
+            q1 *= 2;
+            r1 *= 2;
+            if (r1 >= anc)
+            {
+                ++q1;
+                r1 -= anc;
+            }
+            q2 *= 2;
+            r2 *= 2;
+            if (r2 >= ad)
+            {
+                ++q2;
+                r2 -= ad;
+            }
+            delta = ad - r2;
+        } while (q1 < delta || (q1 == delta && r1 == 0));
+
+        SignedMagic magic;
+        magic.multiplier = (int32_t)(q2 + 1);
+        if (d < 0)
+            magic.multiplier = (int32_t)(0u - (uint32_t)magic.multiplier);
+        magic.shift = p - 32;
+        return magic;
+    }
+
+    bool expandConstDivide(std::vector<MachineInstr> &out, PReg dst, PReg n, int32_t d, bool remainder,
+                           const std::vector<PReg> &scratch)
+    {
+        // INT_MIN has no positive counterpart; leave it to div.
+        if (d == 0 || d == INT32_MIN || scratch.size() < 2)
+            return false;
+
+        const size_t start = out.size();
+        const PReg q = scratch[0];
+        const PReg t = scratch[1];
+        const uint32_t ad = (uint32_t)std::abs(d);
+
+        if (ad == 1)
+        {
+            if (remainder)
+                append(out, MOpcode::LI, {reg(dst), imm(0)});
+            else if (d < 0)
+                append(out, MOpcode::SUBU, {reg(dst), reg(PReg::ZERO), reg(n)});
+            else if (dst != n)
+                append(out, MOpcode::MOVE, {reg(dst), reg(n)});
+            return true;
+        }
+
+        if ((ad & (ad - 1)) == 0)
+        {
+            // Round towards zero: add 2^k - 1 to negative dividends first.
+            int k = __builtin_ctz(ad);
+            if (k == 1)
+            {
+                append(out, MOpcode::SRL, {reg(t), reg(n), imm(31)});
+            }
+            else
+            {
+                append(out, MOpcode::SRA, {reg(t), reg(n), imm(k - 1)});
+                append(out, MOpcode::SRL, {reg(t), reg(t), imm(32 - k)});
+            }
+            append(out, MOpcode::ADDU, {reg(t), reg(n), reg(t)});
+            if (remainder)
+            {
+                // n % d == n % |d| == n - ((n + bias) & -2^k)
+                append(out, MOpcode::SRA, {reg(t), reg(t), imm(k)});
+                append(out, MOpcode::SLL, {reg(t), reg(t), imm(k)});
+                append(out, MOpcode::SUBU, {reg(dst), reg(n), reg(t)});
+            }
+            else if (d < 0)
+            {
+                append(out, MOpcode::SRA, {reg(t), reg(t), imm(k)});
+                append(out, MOpcode::SUBU, {reg(dst), reg(PReg::ZERO), reg(t)});
+            }
+            else
+            {
+                append(out, MOpcode::SRA, {reg(dst), reg(t), imm(k)});
+            }
+        }
+        else
+        {
+            SignedMagic magic = signedMagic(d);
+            append(out, MOpcode::LI, {reg(t), imm(magic.multiplier)});
+            append(out, MOpcode::MULT, {reg(n), reg(t)});
+            append(out, MOpcode::MFHI, {reg(q)});
+            if (d > 0 && magic.multiplier < 0)
+                append(out, MOpcode::ADDU, {reg(q), reg(q), reg(n)});
+            else if (d < 0 && magic.multiplier > 0)
+                append(out, MOpcode::SUBU, {reg(q), reg(q), reg(n)});
+            if (magic.shift > 0)
+                append(out, MOpcode::SRA, {reg(q), reg(q), imm(magic.shift)});
+            // Add one to negative quotients to round towards zero.
+            append(out, MOpcode::SRL, {reg(t), reg(q), imm(31)});
+            if (!remainder)
+            {
+                append(out, MOpcode::ADDU, {reg(dst), reg(q), reg(t)});
+            }
+            else
+            {
+                append(out, MOpcode::ADDU, {reg(q), reg(q), reg(t)});
+                std::vector<PReg> mulScratch(scratch.begin() + 1, scratch.end());
+                if (!expandConstMultiply(out, t, q, d, mulScratch))
+                {
+                    append(out, MOpcode::LI, {reg(t), imm(d)});
+                    append(out, MOpcode::MUL, {reg(t), reg(q), reg(t)});
+                }
+                append(out, MOpcode::SUBU, {reg(dst), reg(n), reg(t)});
+            }
+        }
+
+        int cost = 0;
+        for (size_t i = start; i < out.size(); ++i)
+            cost += marsCost(out[i]);
+        int divCost = marsCost(MachineInstr(MOpcode::LI, {reg(t), imm(d)})) + kMarsDivCost + kMarsOtherCost;
+        if (cost >= divCost)
+        {
+            out.erase(out.begin() + start, out.end());
+            return false;
+        }
+        return true;
+    }
+
+} // namespace backend
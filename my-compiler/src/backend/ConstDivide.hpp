@@ -0,0 +1,33 @@
+#pragma once
+
+#include "MachineIR.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace backend
+{
+
+    // Magic number for signed division by a constant d with |d| >= 2
+    // (Granlund-Montgomery, as in Hacker's Delight 10-1): with
+    // q = MULSH(multiplier, n), corrected by +n if d > 0 and multiplier < 0,
+    // or by -n if d < 0 and multiplier > 0, n / d is
+    // SRA(q, shift) + SRL(SRA(q, shift), 31).
+    struct SignedMagic
+    {
+        int32_t multiplier;
+        int shift;
+    };
+
+    SignedMagic signedMagic(int32_t d);
+
+    // Appends dst = n / d (or n % d if `remainder`) to `out` without a div,
+    // using mult/mfhi with a magic number, or shifts when |d| is a power of
+    // two; remainders are n - (n / d) * d. Needs two registers in `scratch`,
+    // which must not contain n; dst may alias n. Returns false, appending
+    // nothing, when the sequence is not cheaper than li + div under the MARS
+    // weights.
+    bool expandConstDivide(std::vector<MachineInstr> &out, PReg dst, PReg n, int32_t d, bool remainder,
+                           const std::vector<PReg> &scratch);
+
+} // namespace backend
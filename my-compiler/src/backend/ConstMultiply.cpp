@@ -0,0 +1,189 @@
+#include "ConstMultiply.hpp"
+#include "MarsCost.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace backend
+{
+
+    namespace
+    {
+
+        // Depth-limited search from c down to 1. Each candidate reduces c to
+        // some d, solves d * x first and appends one or two steps.
+        struct Search
+        {
+            // Largest budget under which c is known to have no plan.
+            std::unordered_map<int64_t, int> failedBudget;
+
+            // Shortest steps computing c * x from x, with the result as the
+            // last value; false if every plan needs more than `budget` steps.
+            bool solve(int64_t c, int budget, std::vector<MulStep> &out)
+            {
+                if (c == 1)
+                {
+                    out.clear();
+                    return true;
+                }
+                if (budget <= 0 || c == 0)
+                    return false;
+                auto it = failedBudget.find(c);
+                if (it != failedBudget.end() && it->second >= budget)
+                    return false;
+
+                std::vector<MulStep> best;
+                bool found = false;
+                auto consider = [&](int64_t d, int extra, auto &&append)
+                {
+                    int limit = (found ? (int)best.size() - 1 : budget) - extra;
+                    if (limit < 0 || d == c)
+                        return;
+                    std::vector<MulStep> sub;
+                    if (!solve(d, limit, sub))
+                        return;
+                    int v = (int)sub.size(); // value holding d * x
+                    append(sub, v);
+                    best = std::move(sub);
+                    found = true;
+                };
+
+                // c = d << k
+                if ((c & 1) == 0)
+                {
+                    int k = __builtin_ctzll((uint64_t)c);
+                    consider(c >> k, 1, [&](std::vector<MulStep> &s, int v)
+                             { s.push_back({MulStep::Kind::Shl, v, 0, k}); });
+                }
+                // c = d * (2^k + 1) = (d << k) + d, c = d * (2^k - 1) = (d << k) - d
+                for (int k = 1; k < 32; ++k)
+                {
+                    int64_t p = (int64_t)1 << k;
+                    if (c % (p + 1) == 0)
+                    {
+                        consider(c / (p + 1), 2, [&](std::vector<MulStep> &s, int v)
+                                 {
+                                     s.push_back({MulStep::Kind::Shl, v, 0, k});
+                                     s.push_back({MulStep::Kind::Add, v + 1, v, 0}); });
+                    }
+                    if (k >= 2 && c % (p - 1) == 0)
+                    {
+                        consider(c / (p - 1), 2, [&](std::vector<MulStep> &s, int v)
+                                 {
+                                     s.push_back({MulStep::Kind::Shl, v, 0, k});
+                                     s.push_back({MulStep::Kind::Sub, v + 1, v, 0}); });
+                    }
+                }
+                // c = d + 1, c = d - 1
+                consider(c - 1, 1, [&](std::vector<MulStep> &s, int v)
+                         { s.push_back({MulStep::Kind::Add, v, 0, 0}); });
+                consider(c + 1, 1, [&](std::vector<MulStep> &s, int v)
+                         { s.push_back({MulStep::Kind::Sub, v, 0, 0}); });
+                // c = -d, c = 1 - d
+                if (c < 0)
+                {
+                    consider(-c, 1, [&](std::vector<MulStep> &s, int v)
+                             { s.push_back({MulStep::Kind::Neg, v, 0, 0}); });
+                    consider(1 - c, 1, [&](std::vector<MulStep> &s, int v)
+                             { s.push_back({MulStep::Kind::Sub, 0, v, 0}); });
+                }
+
+                if (found)
+                    out = std::move(best);
+                else
+                    failedBudget[c] = budget;
+                return found;
+            }
+        };
+
+    } // namespace
+
+    bool planConstMultiply(int32_t c, int maxSteps, std::vector<MulStep> &plan)
+    {
+        if (c == 0)
+            return false;
+        Search search;
+        // 0x80000000 is its own negation; as an unsigned power of two it is
+        // a plain shift.
+        int64_t target = c == INT32_MIN ? (int64_t)1 << 31 : (int64_t)c;
+        return search.solve(target, maxSteps, plan);
+    }
+
+    bool expandConstMultiply(std::vector<MachineInstr> &out, PReg dst, PReg src, int32_t c,
+                             const std::vector<PReg> &scratch)
+    {
+        if (c == 0)
+        {
+            out.emplace_back(MOpcode::LI, std::vector<MOperand>{MOperand::preg(dst), MOperand::immediate(0)});
+            return true;
+        }
+        if (c == 1)
+        {
+            if (dst != src)
+                out.emplace_back(MOpcode::MOVE, std::vector<MOperand>{MOperand::preg(dst), MOperand::preg(src)});
+            return true;
+        }
+
+        // Every step is a single ALU instruction.
+        int mulCost = marsCost(MachineInstr(MOpcode::LI, {MOperand::preg(dst), MOperand::immediate(c)})) + kMarsMulCost;
+        std::vector<MulStep> plan;
+        if (!planConstMultiply(c, (mulCost - 1) / kMarsOtherCost, plan))
+            return false;
+
+        // Give each intermediate a scratch register, reusing those of values
+        // whose last use is the step being assigned.
+        const int n = (int)plan.size();
+        std::vector<int> lastUse(n + 1, -1);
+        for (int i = 0; i < n; ++i)
+        {
+            lastUse[plan[i].lhs] = i;
+            if (plan[i].kind == MulStep::Kind::Add || plan[i].kind == MulStep::Kind::Sub)
+                lastUse[plan[i].rhs] = i;
+        }
+        std::vector<PReg> location(n + 1, src);
+        std::vector<PReg> free(scratch.rbegin(), scratch.rend());
+        for (int i = 0; i < n; ++i)
+        {
+            for (int v : {plan[i].lhs, plan[i].rhs})
+            {
+                if (v > 0 && lastUse[v] == i && std::find(free.begin(), free.end(), location[v]) == free.end())
+                    free.push_back(location[v]);
+            }
+            if (i + 1 == n)
+            {
+                location[i + 1] = dst;
+            }
+            else
+            {
+                if (free.empty())
+                    return false;
+                location[i + 1] = free.back();
+                free.pop_back();
+            }
+        }
+
+        for (int i = 0; i < n; ++i)
+        {
+            const MulStep &step = plan[i];
+            MOperand d = MOperand::preg(location[i + 1]);
+            MOperand a = MOperand::preg(location[step.lhs]);
+            switch (step.kind)
+            {
+            case MulStep::Kind::Shl:
+                out.emplace_back(MOpcode::SLL, std::vector<MOperand>{d, a, MOperand::immediate(step.shamt)});
+                break;
+            case MulStep::Kind::Add:
+                out.emplace_back(MOpcode::ADDU, std::vector<MOperand>{d, a, MOperand::preg(location[step.rhs])});
+                break;
+            case MulStep::Kind::Sub:
+                out.emplace_back(MOpcode::SUBU, std::vector<MOperand>{d, a, MOperand::preg(location[step.rhs])});
+                break;
+            case MulStep::Kind::Neg:
+                out.emplace_back(MOpcode::SUBU, std::vector<MOperand>{d, MOperand::preg(PReg::ZERO), a});
+                break;
+            }
+        }
+        return true;
+    }
+
+} // namespace backend
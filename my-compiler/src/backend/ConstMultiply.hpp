@@ -0,0 +1,42 @@
+#pragma once
+
+#include "MachineIR.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace backend
+{
+
+    // One step of a shift/add sequence computing x * c. Value 0 is x and
+    // step i defines value i + 1; operands refer to earlier values.
+    struct MulStep
+    {
+        enum class Kind
+        {
+            Shl, // v = lhs << shamt
+            Add, // v = lhs + rhs
+            Sub, // v = lhs - rhs
+            Neg, // v = 0 - lhs
+        };
+
+        Kind kind;
+        int lhs;
+        int rhs = 0;
+        int shamt = 0;
+    };
+
+    // Finds a shortest sequence of at most `maxSteps` shifts, adds, subtracts
+    // and negations computing x * c (mod 2^32). Returns false if none exists
+    // within the budget. c must not be 0; for c == 1 the plan is empty.
+    bool planConstMultiply(int32_t c, int maxSteps, std::vector<MulStep> &plan);
+
+    // Appends dst = src * c to `out` as shifts and adds, if that is cheaper
+    // than li + mul under the MARS weights. Intermediates live in `scratch`,
+    // which must not contain src; dst is only written by the last
+    // instruction, so it may alias src. Returns false, appending nothing,
+    // when the multiply should stay.
+    bool expandConstMultiply(std::vector<MachineInstr> &out, PReg dst, PReg src, int32_t c,
+                             const std::vector<PReg> &scratch);
+
+} // namespace backend
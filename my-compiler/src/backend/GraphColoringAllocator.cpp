@@ -0,0 +1,379 @@
+#include "GraphColoringAllocator.hpp"
+#include "Liveness.hpp"
+
+#include "../midend/llvm/value/IrFunction.hpp"
+#include "../midend/llvm/value/IrBasicBlock.hpp"
+#include "../midend/llvm/instr/Instr.hpp"
+#include "../midend/llvm/instr/CallInstr.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <unordered_set>
+#include <vector>
+
+namespace backend
+{
+
+    namespace
+    {
+
+        double blockWeight(int depth)
+        {
+            return std::pow(10.0, std::min(depth, 8));
+        }
+
+        struct Graph
+        {
+            std::vector<std::unordered_set<int>> adj;
+            std::vector<bool> crossesCall;
+            std::vector<double> cost;
+            std::vector<std::pair<int, int>> moves;
+            std::vector<int> alias; // coalescing union-find
+
+            explicit Graph(size_t n) : adj(n), crossesCall(n, false), cost(n, 0.0), alias(n)
+            {
+                for (size_t i = 0; i < n; ++i)
+                    alias[i] = (int)i;
+            }
+
+            int find(int v)
+            {
+                while (alias[v] != v)
+                {
+                    alias[v] = alias[alias[v]];
+                    v = alias[v];
+                }
+                return v;
+            }
+
+            void addEdge(int a, int b)
+            {
+                if (a == b)
+                    return;
+                adj[a].insert(b);
+                adj[b].insert(a);
+            }
+
+            int colorsFor(int v) const
+            {
+                return (int)(crossesCall[v] ? calleeSavedRegisters().size()
+                                            : callerSavedRegisters().size() + calleeSavedRegisters().size());
+            }
+        };
+
+        void buildGraph(IrFunction *func, const FunctionLiveness &lv, Graph &g)
+        {
+            for (auto *bb : lv.blocks)
+            {
+                double w = blockWeight(lv.loopDepth.at(bb));
+                std::vector<Instr *> body;
+                std::vector<Instr *> phis;
+                Instr *term = blockTerminator(bb);
+                for (auto *instr : bb->instructions)
+                {
+                    if (instr->instrType == InstrType::PHI)
+                        phis.push_back(instr);
+                    else
+                        body.push_back(instr);
+                    if (instr == term)
+                        break;
+                }
+
+                LiveSet live = lv.liveOut.at(bb);
+                for (auto it = body.rbegin(); it != body.rend(); ++it)
+                {
+                    Instr *instr = *it;
+                    int d = lv.indexOf(instr);
+
+                    // A copy does not make its source interfere with its
+                    // result, which is what lets the two be coalesced.
+                    int copySrc = -1;
+                    if (instr->instrType == InstrType::ZEXT)
+                    {
+                        copySrc = lv.indexOf(instr->getOperand(0));
+                        if (d >= 0 && copySrc >= 0)
+                            g.moves.push_back({d, copySrc});
+                    }
+
+                    if (d >= 0)
+                    {
+                        live.reset(d);
+                        live.forEach([&](int v)
+                                     {
+                                         if (v != copySrc)
+                                             g.addEdge(d, v); });
+                        g.cost[d] += w;
+                    }
+
+                    if (isRealCall(instr))
+                    {
+                        live.forEach([&](int v)
+                                     { g.crossesCall[v] = true; });
+                    }
+
+                    for (auto *value : readValues(instr))
+                    {
+                        int u = lv.indexOf(value);
+                        if (u >= 0)
+                        {
+                            live.set(u);
+                            g.cost[u] += w;
+                        }
+                    }
+                }
+
+                // Phi results are written together on every incoming edge, so
+                // they interfere with each other and with whatever is live into
+                // the block body.
+                for (size_t i = 0; i < phis.size(); ++i)
+                {
+                    int p = lv.indexOf(phis[i]);
+                    if (p < 0)
+                        continue;
+                    live.forEach([&](int v)
+                                 { g.addEdge(p, v); });
+                    for (size_t j = i + 1; j < phis.size(); ++j)
+                    {
+                        int q = lv.indexOf(phis[j]);
+                        if (q >= 0)
+                            g.addEdge(p, q);
+                    }
+
+                    auto *phi = phis[i];
+                    for (size_t k = 0; k + 1 < phi->operandList.size(); k += 2)
+                    {
+                        auto *from = dynamic_cast<IrBasicBlock *>(phi->getOperand((int)k + 1));
+                        double pw = from && lv.loopDepth.count(from) ? blockWeight(lv.loopDepth.at(from)) : w;
+                        g.cost[p] += pw;
+                        int u = lv.indexOf(phi->getOperand((int)k));
+                        if (u >= 0)
+                        {
+                            g.cost[u] += pw;
+                            g.moves.push_back({p, u});
+                        }
+                    }
+                }
+            }
+
+            // Parameters are all defined on entry.
+            if (!lv.blocks.empty())
+            {
+                const LiveSet &entryLive = lv.liveIn.at(lv.blocks.front());
+                for (size_t i = 0; i < func->params.size(); ++i)
+                {
+                    int p = lv.indexOf(func->params[i]);
+                    entryLive.forEach([&](int v)
+                                      { g.addEdge(p, v); });
+                    for (size_t j = i + 1; j < func->params.size(); ++j)
+                        g.addEdge(p, lv.indexOf(func->params[j]));
+                    g.cost[p] += 1.0;
+                }
+            }
+        }
+
+        // Briggs: merging is safe if the combined node has fewer than K
+        // neighbours of significant degree.
+        bool briggsSafe(Graph &g, int a, int b)
+        {
+            bool crosses = g.crossesCall[a] || g.crossesCall[b];
+            int k = (int)(crosses ? calleeSavedRegisters().size()
+                                  : callerSavedRegisters().size() + calleeSavedRegisters().size());
+            std::unordered_set<int> neighbours(g.adj[a].begin(), g.adj[a].end());
+            neighbours.insert(g.adj[b].begin(), g.adj[b].end());
+            int significant = 0;
+            for (int t : neighbours)
+            {
+                if ((int)g.adj[t].size() >= g.colorsFor(t))
+                {
+                    if (++significant >= k)
+                        return false;
+                }
+            }
+            return true;
+        }
+
+        void coalesce(Graph &g)
+        {
+            bool changed = true;
+            while (changed)
+            {
+                changed = false;
+                for (auto &[x, y] : g.moves)
+                {
+                    int a = g.find(x);
+                    int b = g.find(y);
+                    if (a == b || g.adj[a].count(b))
+                        continue;
+                    if (!briggsSafe(g, a, b))
+                        continue;
+
+                    for (int t : g.adj[b])
+                    {
+                        g.adj[t].erase(b);
+                        g.addEdge(a, t);
+                    }
+                    g.adj[b].clear();
+                    g.crossesCall[a] = g.crossesCall[a] || g.crossesCall[b];
+                    g.cost[a] += g.cost[b];
+                    g.alias[b] = a;
+                    changed = true;
+                }
+            }
+        }
+
+    } // namespace
+
+    RegisterAssignment GraphColoringAllocator::allocate(IrFunction *func)
+    {
+        RegisterAssignment result;
+        result.method = name();
+        FunctionLiveness lv = computeLiveness(func);
+        const int n = (int)lv.values.size();
+        if (n == 0)
+            return result;
+
+        Graph g(n);
+        buildGraph(func, lv, g);
+        coalesce(g);
+
+        // Simplify: repeatedly remove nodes with degree < K; when stuck, push the
+        // cheapest spill candidate optimistically and keep going.
+        std::vector<int> nodes;
+        for (int v = 0; v < n; ++v)
+        {
+            if (g.find(v) == v)
+                nodes.push_back(v);
+        }
+        std::vector<int> degree(n, 0);
+        std::vector<bool> removed(n, false);
+        for (int v : nodes)
+            degree[v] = (int)g.adj[v].size();
+
+        std::vector<int> stack;
+        std::vector<int> lowWork;
+        std::vector<bool> inLow(n, false);
+        for (int v : nodes)
+        {
+            if (degree[v] < g.colorsFor(v))
+            {
+                lowWork.push_back(v);
+                inLow[v] = true;
+            }
+        }
+
+        size_t remaining = nodes.size();
+        auto removeNode = [&](int v)
+        {
+            removed[v] = true;
+            stack.push_back(v);
+            --remaining;
+            for (int t : g.adj[v])
+            {
+                if (removed[t])
+                    continue;
+                if (--degree[t] < g.colorsFor(t) && !inLow[t])
+                {
+                    lowWork.push_back(t);
+                    inLow[t] = true;
+                }
+            }
+        };
+
+        while (remaining > 0)
+        {
+            if (!lowWork.empty())
+            {
+                int v = lowWork.back();
+                lowWork.pop_back();
+                if (!removed[v])
+                    removeNode(v);
+                continue;
+            }
+
+            int best = -1;
+            double bestScore = 0.0;
+            for (int v : nodes)
+            {
+                if (removed[v])
+                    continue;
+                double score = g.cost[v] / (degree[v] + 1);
+                if (best < 0 || score < bestScore)
+                {
+                    best = v;
+                    bestScore = score;
+                }
+            }
+            removeNode(best);
+        }
+
+        // Select: colour in reverse removal order, preferring a colour already
+        // given to a move partner so the copy disappears.
+        std::vector<std::vector<int>> partners(n);
+        for (auto &[x, y] : g.moves)
+        {
+            int a = g.find(x);
+            int b = g.find(y);
+            if (a != b)
+            {
+                partners[a].push_back(b);
+                partners[b].push_back(a);
+            }
+        }
+
+        std::vector<int> color(n, -1); // PReg, or -1 for an actual spill
+        std::set<PReg> usedCallee;
+        while (!stack.empty())
+        {
+            int v = stack.back();
+            stack.pop_back();
+
+            std::unordered_set<int> taken;
+            for (int t : g.adj[v])
+            {
+                if (color[t] >= 0)
+                    taken.insert(color[t]);
+            }
+
+            std::vector<PReg> allowed;
+            if (!g.crossesCall[v])
+                allowed = callerSavedRegisters();
+            allowed.insert(allowed.end(), calleeSavedRegisters().begin(), calleeSavedRegisters().end());
+
+            int chosen = -1;
+            for (int p : partners[v])
+            {
+                int c = color[p];
+                if (c >= 0 && !taken.count(c) && std::find(allowed.begin(), allowed.end(), (PReg)c) != allowed.end())
+                {
+                    chosen = c;
+                    break;
+                }
+            }
+            if (chosen < 0)
+            {
+                for (PReg r : allowed)
+                {
+                    if (!taken.count((int)r))
+                    {
+                        chosen = (int)r;
+                        break;
+                    }
+                }
+            }
+            color[v] = chosen;
+            if (chosen >= 0 && isCalleeSaved((PReg)chosen))
+                usedCallee.insert((PReg)chosen);
+        }
+
+        for (int v = 0; v < n; ++v)
+        {
+            int c = color[g.find(v)];
+            if (c >= 0)
+                result.registers[lv.values[v]] = (PReg)c;
+        }
+        result.usedCalleeSaved.assign(usedCallee.begin(), usedCallee.end());
+        return result;
+    }
+
+} // namespace backend
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "RegisterAllocator.hpp"
+
+namespace backend
+{
+
+    // Chaitin-Briggs allocator over SSA values:
+    //   build interference graph from liveness -> conservative (Briggs)
+    //   coalescing of phi/zext copies -> simplify with optimistic spilling ->
+    //   select with copy-biased colors.
+    // Values live across a call are restricted to callee-saved registers.
+    // Spill candidates minimize cost/degree, where the cost counts defs and
+    // uses weighted by 10^loopDepth.
+    class GraphColoringAllocator final : public RegisterAllocator
+    {
+    public:
+        std::string name() const override { return "graph-coloring"; }
+        RegisterAssignment allocate(IrFunction *func) override;
+    };
+
+} // namespace backend
@@ -0,0 +1,214 @@
+#include "LinearScanAllocator.hpp"
+#include "Liveness.hpp"
+
+#include "../midend/llvm/value/IrFunction.hpp"
+#include "../midend/llvm/value/IrBasicBlock.hpp"
+#include "../midend/llvm/instr/Instr.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <set>
+#include <vector>
+
+namespace backend
+{
+
+    namespace
+    {
+
+        struct Interval
+        {
+            int start = INT_MAX;
+            int end = -1;
+            bool crossesCall = false;
+
+            void extend(int pos)
+            {
+                start = std::min(start, pos);
+                end = std::max(end, pos);
+            }
+        };
+
+        // Numbers the function linearly and builds one interval per value.
+        // Each block owns a start slot (live-in values, phi results), one slot
+        // per instruction, and an end slot (live-out values, outgoing phi
+        // copies).
+        std::vector<Interval> buildIntervals(const FunctionLiveness &lv, std::vector<int> &callPositions)
+        {
+            std::vector<Interval> intervals(lv.values.size());
+            std::unordered_map<IrBasicBlock *, int> blockStart, blockEnd;
+
+            int pos = 0;
+            for (auto *bb : lv.blocks)
+            {
+                blockStart[bb] = pos++;
+                Instr *term = blockTerminator(bb);
+                for (auto *instr : bb->instructions)
+                {
+                    if (instr->instrType != InstrType::PHI)
+                        ++pos;
+                    if (instr == term)
+                        break;
+                }
+                blockEnd[bb] = pos++;
+            }
+
+            for (auto *bb : lv.blocks)
+            {
+                int start = blockStart[bb];
+                int end = blockEnd[bb];
+                lv.liveIn.at(bb).forEach([&](int v)
+                                         { intervals[v].extend(start); });
+                lv.liveOut.at(bb).forEach([&](int v)
+                                          { intervals[v].extend(end); });
+
+                int p = start;
+                Instr *term = blockTerminator(bb);
+                for (auto *instr : bb->instructions)
+                {
+                    int d = lv.indexOf(instr);
+                    if (instr->instrType == InstrType::PHI)
+                    {
+                        if (d >= 0)
+                        {
+                            intervals[d].extend(start);
+                            for (size_t k = 1; k < instr->operandList.size(); k += 2)
+                            {
+                                auto *from = dynamic_cast<IrBasicBlock *>(instr->getOperand((int)k));
+                                auto it = blockEnd.find(from);
+                                if (it != blockEnd.end())
+                                    intervals[d].extend(it->second);
+                            }
+                        }
+                    }
+                    else
+                    {
+                        ++p;
+                        if (d >= 0)
+                            intervals[d].extend(p);
+                        for (auto *value : readValues(instr))
+                        {
+                            int u = lv.indexOf(value);
+                            if (u >= 0)
+                                intervals[u].extend(p);
+                        }
+                        if (isRealCall(instr))
+                            callPositions.push_back(p);
+                    }
+                    if (instr == term)
+                        break;
+                }
+            }
+
+            // Parameters are defined on entry.
+            if (!lv.blocks.empty())
+            {
+                for (size_t i = 0; i < lv.values.size(); ++i)
+                {
+                    if (!dynamic_cast<Instr *>(lv.values[i]))
+                        intervals[i].extend(blockStart[lv.blocks.front()]);
+                }
+            }
+
+            // A value survives a call if the call lies strictly inside its
+            // interval: one defined by the call, or last used as its argument,
+            // does not.
+            for (auto &iv : intervals)
+            {
+                auto it = std::upper_bound(callPositions.begin(), callPositions.end(), iv.start);
+                iv.crossesCall = it != callPositions.end() && *it < iv.end;
+            }
+            return intervals;
+        }
+
+    } // namespace
+
+    RegisterAssignment LinearScanAllocator::allocate(IrFunction *func)
+    {
+        RegisterAssignment result;
+        result.method = name();
+        FunctionLiveness lv = computeLiveness(func);
+        const int n = (int)lv.values.size();
+        if (n == 0)
+            return result;
+
+        std::vector<int> callPositions;
+        std::vector<Interval> intervals = buildIntervals(lv, callPositions);
+
+        std::vector<PReg> regs = callerSavedRegisters();
+        const int numCaller = (int)regs.size();
+        regs.insert(regs.end(), calleeSavedRegisters().begin(), calleeSavedRegisters().end());
+        auto isCalleeSaved = [&](int r)
+        { return r >= numCaller; };
+
+        std::vector<int> order(n);
+        for (int v = 0; v < n; ++v)
+            order[v] = v;
+        std::sort(order.begin(), order.end(), [&](int a, int b)
+                  { return intervals[a].start != intervals[b].start ? intervals[a].start < intervals[b].start : a < b; });
+
+        std::vector<int> reg(n, -1);
+        std::vector<bool> busy(regs.size(), false);
+        std::set<std::pair<int, int>> active; // (end, value), ordered by end
+        std::set<PReg> usedCallee;
+
+        for (int v : order)
+        {
+            const Interval &cur = intervals[v];
+
+            // Expire intervals that ended before this one starts.
+            while (!active.empty() && active.begin()->first < cur.start)
+            {
+                busy[reg[active.begin()->second]] = false;
+                active.erase(active.begin());
+            }
+
+            // Caller-saved registers first: callee-saved ones cost a save and
+            // restore in the prologue/epilogue.
+            int chosen = -1;
+            for (int r = cur.crossesCall ? numCaller : 0; r < (int)regs.size(); ++r)
+            {
+                if (!busy[r])
+                {
+                    chosen = r;
+                    break;
+                }
+            }
+
+            if (chosen < 0)
+            {
+                // Spill whichever suitable interval ends last.
+                for (auto it = active.rbegin(); it != active.rend(); ++it)
+                {
+                    int other = it->second;
+                    if (cur.crossesCall && !isCalleeSaved(reg[other]))
+                        continue;
+                    if (it->first > cur.end)
+                    {
+                        chosen = reg[other];
+                        reg[other] = -1;
+                        active.erase(std::next(it).base());
+                    }
+                    break;
+                }
+                if (chosen < 0)
+                    continue;
+            }
+
+            reg[v] = chosen;
+            busy[chosen] = true;
+            active.insert({cur.end, v});
+            if (isCalleeSaved(chosen))
+                usedCallee.insert(regs[chosen]);
+        }
+
+        for (int v = 0; v < n; ++v)
+        {
+            if (reg[v] >= 0)
+                result.registers[lv.values[v]] = regs[reg[v]];
+        }
+        result.usedCalleeSaved.assign(usedCallee.begin(), usedCallee.end());
+        return result;
+    }
+
+} // namespace backend
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "RegisterAllocator.hpp"
+
+namespace backend
+{
+
+    // Poletto-Sarkar linear scan over SSA values. Instructions are numbered in
+    // IrFunction::blocks order and every value gets one conservative interval
+    // [first def/live-in, last use/live-out] (lifetime holes are ignored).
+    // Phi results are live from the end of each predecessor, where the edge
+    // copies write them. Intervals spanning a call may only take callee-saved
+    // registers; when no register is free, the interval ending furthest away
+    // is spilled.
+    //
+    // Runs in O(n log n) after liveness, so it is the allocator of choice for
+    // functions too large for an interference graph.
+    class LinearScanAllocator final : public RegisterAllocator
+    {
+    public:
+        std::string name() const override { return "linear-scan"; }
+        RegisterAssignment allocate(IrFunction *func) override;
+    };
+
+} // namespace backend
@@ -0,0 +1,267 @@
+#include "Liveness.hpp"
+#include "NaturalLoops.hpp"
+
+#include "../midend/llvm/value/IrFunction.hpp"
+#include "../midend/llvm/value/IrBasicBlock.hpp"
+#include "../midend/llvm/instr/Instr.hpp"
+#include "../midend/llvm/instr/AllocaInstr.hpp"
+#include "../midend/llvm/value/IrConstantInt.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace backend
+{
+
+    namespace
+    {
+
+        bool isTerminator(const Instr *instr)
+        {
+            return instr->instrType == InstrType::BR || instr->instrType == InstrType::JUMP || instr->instrType == InstrType::RET;
+        }
+
+        void addEdge(FunctionLiveness &lv, IrBasicBlock *from, IrBasicBlock *to)
+        {
+            if (!to)
+                return;
+            auto &s = lv.succ[from];
+            if (std::find(s.begin(), s.end(), to) != s.end())
+                return;
+            s.push_back(to);
+            lv.pred[to].push_back(from);
+        }
+
+        // Nesting depth of each block: the natural loops containing it.
+        void computeLoopDepth(FunctionLiveness &lv)
+        {
+            const int n = (int)lv.blocks.size();
+            std::unordered_map<IrBasicBlock *, int> index;
+            for (int i = 0; i < n; ++i)
+                index[lv.blocks[i]] = i;
+            std::vector<std::vector<int>> succ(n), pred(n);
+            for (int i = 0; i < n; ++i)
+            {
+                for (auto *to : lv.succ[lv.blocks[i]])
+                {
+                    succ[i].push_back(index[to]);
+                    pred[index[to]].push_back(i);
+                }
+            }
+
+            for (auto *bb : lv.blocks)
+                lv.loopDepth[bb] = 0;
+            for (const auto &loop : findNaturalLoops(succ, pred))
+            {
+                for (int i = 0; i < n; ++i)
+                {
+                    if (loop.body[i])
+                        lv.loopDepth[lv.blocks[i]]++;
+                }
+            }
+        }
+
+    } // namespace
+
+    bool isAllocatable(IrValue *v)
+    {
+        if (!v)
+            return false;
+        auto *instr = dynamic_cast<Instr *>(v);
+        if (!instr)
+            return false;
+        if (instr->type->isVoid())
+            return false;
+        return instr->instrType != InstrType::ALLOCA && !isFusedCompare(instr) && !isFusedAddress(instr);
+    }
+
+    bool isFusedCompare(Instr *instr)
+    {
+        if (instr->instrType != InstrType::ICMP || instr->useList.size() != 1)
+            return false;
+        auto *br = dynamic_cast<Instr *>(instr->useList.front()->user);
+        if (!br || br->instrType != InstrType::BR || br->getOperand(0) != instr)
+            return false;
+        // Adjacent, so the operands stay live until the branch reads them.
+        IrBasicBlock *bb = instr->parentBlock;
+        if (!bb || br->parentBlock != bb || bb->instructions.size() < 2 || bb->instructions.back() != br)
+            return false;
+        return *std::prev(bb->instructions.end(), 2) == instr;
+    }
+
+    bool isFusedAddress(Instr *instr)
+    {
+        if (instr->instrType != InstrType::GEP || instr->useList.size() != 1)
+            return false;
+        auto *user = dynamic_cast<Instr *>(instr->useList.front()->user);
+        if (!user || user->parentBlock != instr->parentBlock)
+            return false;
+        bool isAddress = (user->instrType == InstrType::LOAD && user->getOperand(0) == instr) ||
+                         (user->instrType == InstrType::STORE && user->getOperand(1) == instr &&
+                          user->getOperand(0) != instr);
+        if (!isAddress)
+            return false;
+        int variable = 0;
+        for (size_t i = 1; i < instr->operandList.size(); ++i)
+            variable += dynamic_cast<IrConstantInt *>(instr->getOperand((int)i)) == nullptr;
+        return variable <= 1;
+    }
+
+    std::vector<IrValue *> readValues(Instr *instr)
+    {
+        std::vector<IrValue *> values;
+        if (instr->instrType == InstrType::GEP && isFusedAddress(instr))
+            return values;
+        for (auto *use : instr->operandList)
+        {
+            auto *gep = dynamic_cast<Instr *>(use->value);
+            if (gep && gep->instrType == InstrType::GEP && isFusedAddress(gep))
+            {
+                for (auto *inner : gep->operandList)
+                    values.push_back(inner->value);
+            }
+            else
+            {
+                values.push_back(use->value);
+            }
+        }
+        return values;
+    }
+
+    bool isRealCall(Instr *instr)
+    {
+        if (instr->instrType != InstrType::CALL)
+            return false;
+        auto *callee = dynamic_cast<IrFunction *>(instr->getOperand(0));
+        return !(callee && callee->isBuiltin);
+    }
+
+    Instr *blockTerminator(IrBasicBlock *bb)
+    {
+        for (auto *instr : bb->instructions)
+        {
+            if (isTerminator(instr))
+                return instr;
+        }
+        return nullptr;
+    }
+
+    FunctionLiveness computeLiveness(IrFunction *func)
+    {
+        FunctionLiveness lv;
+        auto addValue = [&](IrValue *v)
+        {
+            if (lv.index.count(v))
+                return;
+            lv.index[v] = (int)lv.values.size();
+            lv.values.push_back(v);
+        };
+
+        for (auto *param : func->params)
+            addValue(param);
+
+        for (auto *bb : func->blocks)
+        {
+            lv.blocks.push_back(bb);
+            (void)lv.succ[bb];
+            (void)lv.pred[bb];
+            for (auto *instr : bb->instructions)
+            {
+                if (isAllocatable(instr))
+                    addValue(instr);
+                if (isTerminator(instr))
+                    break;
+            }
+        }
+
+        for (auto *bb : lv.blocks)
+        {
+            Instr *term = blockTerminator(bb);
+            if (!term)
+                continue;
+            if (term->instrType == InstrType::BR)
+            {
+                addEdge(lv, bb, dynamic_cast<IrBasicBlock *>(term->getOperand(1)));
+                addEdge(lv, bb, dynamic_cast<IrBasicBlock *>(term->getOperand(2)));
+            }
+            else if (term->instrType == InstrType::JUMP)
+            {
+                addEdge(lv, bb, dynamic_cast<IrBasicBlock *>(term->getOperand(0)));
+            }
+        }
+
+        const size_t n = lv.values.size();
+        // Upward-exposed uses and (non-phi + phi) definitions per block, plus
+        // phi operands flowing out of each predecessor.
+        std::unordered_map<IrBasicBlock *, LiveSet> gen, kill, phiOut;
+        for (auto *bb : lv.blocks)
+        {
+            gen[bb] = LiveSet(n);
+            kill[bb] = LiveSet(n);
+            phiOut[bb] = LiveSet(n);
+            lv.liveIn[bb] = LiveSet(n);
+            lv.liveOut[bb] = LiveSet(n);
+        }
+
+        for (auto *bb : lv.blocks)
+        {
+            auto &g = gen[bb];
+            auto &k = kill[bb];
+            for (auto *instr : bb->instructions)
+            {
+                if (instr->instrType == InstrType::PHI)
+                {
+                    // operands: [value0, block0, value1, block1, ...]
+                    for (size_t i = 0; i + 1 < instr->operandList.size(); i += 2)
+                    {
+                        int vi = lv.indexOf(instr->getOperand((int)i));
+                        auto *from = dynamic_cast<IrBasicBlock *>(instr->getOperand((int)i + 1));
+                        if (vi >= 0 && from && phiOut.count(from))
+                            phiOut[from].set(vi);
+                    }
+                }
+                else
+                {
+                    for (auto *value : readValues(instr))
+                    {
+                        int vi = lv.indexOf(value);
+                        if (vi >= 0 && !k.test(vi))
+                            g.set(vi);
+                    }
+                }
+                int di = lv.indexOf(instr);
+                if (di >= 0)
+                    k.set(di);
+                if (isTerminator(instr))
+                    break;
+            }
+        }
+
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+            for (auto it = lv.blocks.rbegin(); it != lv.blocks.rend(); ++it)
+            {
+                auto *bb = *it;
+                auto &out = lv.liveOut[bb];
+                changed |= out.unite(phiOut[bb]);
+                for (auto *s : lv.succ[bb])
+                    changed |= out.unite(lv.liveIn[s]);
+
+                // in = gen | (out - kill)
+                LiveSet in = gen[bb];
+                const auto &k = kill[bb];
+                out.forEach([&](int v)
+                            {
+                                if (!k.test(v))
+                                    in.set(v); });
+                changed |= lv.liveIn[bb].unite(in);
+            }
+        }
+
+        computeLoopDepth(lv);
+        return lv;
+    }
+
+} // namespace backend
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class IrFunction;
+class IrBasicBlock;
+class IrValue;
+class Instr;
+
+namespace backend
+{
+
+    // Dense bitset over value indices. Liveness sets are stored per block, so
+    // a flat word vector keeps the dataflow iteration cheap even for very
+    // large functions.
+    class LiveSet
+    {
+    public:
+        LiveSet() = default;
+        explicit LiveSet(std::size_t n) : words((n + 63) / 64, 0) {}
+
+        bool test(int i) const { return (words[i >> 6] >> (i & 63)) & 1u; }
+        void set(int i) { words[i >> 6] |= (uint64_t(1) << (i & 63)); }
+        void reset(int i) { words[i >> 6] &= ~(uint64_t(1) << (i & 63)); }
+
+        // this |= other; returns true if anything changed.
+        bool unite(const LiveSet &other)
+        {
+            bool changed = false;
+            for (std::size_t w = 0; w < words.size(); ++w)
+            {
+                uint64_t nw = words[w] | other.words[w];
+                if (nw != words[w])
+                {
+                    words[w] = nw;
+                    changed = true;
+                }
+            }
+            return changed;
+        }
+
+        template <typename F>
+        void forEach(F &&f) const
+        {
+            for (std::size_t w = 0; w < words.size(); ++w)
+            {
+                uint64_t bits = words[w];
+                while (bits)
+                {
+                    int b = __builtin_ctzll(bits);
+                    f(int(w * 64 + b));
+                    bits &= bits - 1;
+                }
+            }
+        }
+
+    private:
+        std::vector<uint64_t> words;
+    };
+
+    // Liveness of SSA values over one function. Only values that need a
+    // location of their own are tracked (see isAllocatable); constants,
+    // globals and allocas are rematerialized at every use.
+    //
+    // Phi operands are treated as uses at the end of the corresponding
+    // predecessor, and phi results as definitions at the start of their block,
+    // which matches how the backend lowers phis into edge copies.
+    struct FunctionLiveness
+    {
+        std::vector<IrValue *> values;                 // index -> value
+        std::unordered_map<IrValue *, int> index;      // value -> index
+        std::vector<IrBasicBlock *> blocks;            // function order
+        std::unordered_map<IrBasicBlock *, std::vector<IrBasicBlock *>> succ;
+        std::unordered_map<IrBasicBlock *, std::vector<IrBasicBlock *>> pred;
+        std::unordered_map<IrBasicBlock *, LiveSet> liveIn;
+        std::unordered_map<IrBasicBlock *, LiveSet> liveOut;
+        std::unordered_map<IrBasicBlock *, int> loopDepth;
+
+        int indexOf(IrValue *v) const
+        {
+            auto it = index.find(v);
+            return it == index.end() ? -1 : it->second;
+        }
+    };
+
+    // True for values that the register allocator assigns a location to:
+    // function parameters and every non-void instruction except alloca and
+    // those fused into their user.
+    bool isAllocatable(IrValue *v);
+
+    // A call that clobbers the caller-saved registers. Builtins are lowered
+    // to syscalls, which only clobber $v0/$a0.
+    bool isRealCall(Instr *instr);
+
+    // An icmp whose only use is the conditional branch right after it. The
+    // backend folds it into the branch, so its result never exists.
+    bool isFusedCompare(Instr *instr);
+
+    // A getelementptr with at most one variable index whose only use is the
+    // address of a load or store in the same block. The backend folds it
+    // into that access, so its operands are read there instead.
+    bool isFusedAddress(Instr *instr);
+
+    // Values a non-phi instruction reads once fused instructions are folded
+    // into their users.
+    std::vector<IrValue *> readValues(Instr *instr);
+
+    // Returns the first terminator of the block (anything emitted after it is
+    // unreachable), or nullptr if the block has none.
+    Instr *blockTerminator(IrBasicBlock *bb);
+
+    FunctionLiveness computeLiveness(IrFunction *func);
+
+} // namespace backend
@@ -0,0 +1,189 @@
+#include "MachineIR.hpp"
+
+namespace backend
+{
+
+    namespace
+    {
+
+        const char *const kRegNames[] = {
+            "$zero", "$at", "$v0", "$v1", "$a0", "$a1", "$a2", "$a3",
+            "$t0", "$t1", "$t2", "$t3", "$t4", "$t5", "$t6", "$t7",
+            "$s0", "$s1", "$s2", "$s3", "$s4", "$s5", "$s6", "$s7",
+            "$t8", "$t9", "$k0", "$k1", "$gp", "$sp", "$fp", "$ra"};
+
+        // Indexed by MOpcode.
+        const MachineOpcodeInfo kOpcodeInfo[] = {
+            {"addu", true, false, false},
+            {"subu", true, false, false},
+            {"mul", true, false, false},
+            {"and", true, false, false},
+            {"or", true, false, false},
+            {"xor", true, false, false},
+            {"nor", true, false, false},
+            {"slt", true, false, false},
+            {"sltu", true, false, false},
+            {"sllv", true, false, false},
+            {"srlv", true, false, false},
+            {"srav", true, false, false},
+            {"addiu", true, false, false},
+            {"andi", true, false, false},
+            {"ori", true, false, false},
+            {"xori", true, false, false},
+            {"slti", true, false, false},
+            {"sltiu", true, false, false},
+            {"sll", true, false, false},
+            {"srl", true, false, false},
+            {"sra", true, false, false},
+            {"mult", false, false, false},
+            {"multu", false, false, false},
+            {"div", false, false, false},
+            {"divu", false, false, false},
+            {"mfhi", true, false, false},
+            {"mflo", true, false, false},
+            {"li", true, false, false},
+            {"la", true, false, false},
+            {"move", true, false, false},
+            {"lw", true, false, false},
+            {"lb", true, false, false},
+            {"sw", false, false, false},
+            {"sb", false, false, false},
+            {"j", false, false, true},
+            {"jal", false, false, false},
+            {"jr", false, false, true},
+            {"beq", false, true, false},
+            {"bne", false, true, false},
+            {"blt", false, true, false},
+            {"bge", false, true, false},
+            {"bgt", false, true, false},
+            {"ble", false, true, false},
+            {"beqz", false, true, false},
+            {"bnez", false, true, false},
+            {"bltz", false, true, false},
+            {"blez", false, true, false},
+            {"bgtz", false, true, false},
+            {"bgez", false, true, false},
+            {"syscall", false, false, false},
+            {"#", false, false, false},
+        };
+
+        static_assert(sizeof(kOpcodeInfo) / sizeof(kOpcodeInfo[0]) == (size_t)MOpcode::COMMENT + 1,
+                      "kOpcodeInfo must cover every MOpcode");
+
+        MOperand baseOf(const MOperand &mem)
+        {
+            MOperand r;
+            r.kind = MOperand::Kind::Reg;
+            r.reg = mem.reg;
+            return r;
+        }
+
+    } // namespace
+
+    const char *pregName(PReg r)
+    {
+        return kRegNames[(int)r];
+    }
+
+    const MachineOpcodeInfo &opcodeInfo(MOpcode op)
+    {
+        return kOpcodeInfo[(int)op];
+    }
+
+    MOperand MOperand::preg(PReg r)
+    {
+        MOperand o;
+        o.kind = Kind::Reg;
+        o.reg = (int)r;
+        return o;
+    }
+
+    MOperand MOperand::immediate(int64_t v)
+    {
+        MOperand o;
+        o.kind = Kind::Imm;
+        o.imm = v;
+        return o;
+    }
+
+    MOperand MOperand::mem(PReg base, int64_t offset)
+    {
+        MOperand o;
+        o.kind = Kind::Mem;
+        o.reg = (int)base;
+        o.imm = offset;
+        return o;
+    }
+
+    MOperand MOperand::mem(std::string label, int64_t offset, PReg base)
+    {
+        MOperand o = mem(base, offset);
+        o.symbol = std::move(label);
+        return o;
+    }
+
+    MOperand MOperand::label(MachineBasicBlock *bb)
+    {
+        MOperand o;
+        o.kind = Kind::Block;
+        o.block = bb;
+        return o;
+    }
+
+    MOperand MOperand::sym(std::string name)
+    {
+        MOperand o;
+        o.kind = Kind::Symbol;
+        o.symbol = std::move(name);
+        return o;
+    }
+
+    bool MOperand::operator==(const MOperand &o) const
+    {
+        if (kind != o.kind)
+            return false;
+        switch (kind)
+        {
+        case Kind::Reg:
+            return reg == o.reg;
+        case Kind::Imm:
+            return imm == o.imm;
+        case Kind::Mem:
+            return reg == o.reg && imm == o.imm && symbol == o.symbol;
+        case Kind::Block:
+            return block == o.block;
+        case Kind::Symbol:
+            return symbol == o.symbol;
+        }
+        return false;
+    }
+
+    bool MachineInstr::regEffects(std::vector<MOperand> &uses, std::vector<MOperand> &defs) const
+    {
+        if (opcode == MOpcode::JAL)
+            return false;
+        if (opcode == MOpcode::SYSCALL)
+        {
+            uses.push_back(MOperand::preg(PReg::V0));
+            uses.push_back(MOperand::preg(PReg::A0));
+            defs.push_back(MOperand::preg(PReg::V0));
+            return true;
+        }
+        for (size_t i = 0; i < operands.size(); ++i)
+        {
+            const MOperand &o = operands[i];
+            if (o.kind == MOperand::Kind::Mem)
+                uses.push_back(baseOf(o));
+            else if (o.isReg())
+                (i == 0 && info().definesFirst ? defs : uses).push_back(o);
+        }
+        return true;
+    }
+
+    MachineBasicBlock *MachineFunction::addBlock(std::string label)
+    {
+        blocks.push_back(std::make_unique<MachineBasicBlock>(std::move(label)));
+        return blocks.back().get();
+    }
+
+} // namespace backend
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace backend
+{
+
+    // MIPS general-purpose registers, numbered as in the ISA.
+    enum class PReg : uint8_t
+    {
+        ZERO, AT, V0, V1, A0, A1, A2, A3,
+        T0, T1, T2, T3, T4, T5, T6, T7,
+        S0, S1, S2, S3, S4, S5, S6, S7,
+        T8, T9, K0, K1, GP, SP, FP, RA,
+    };
+
+    const char *pregName(PReg r);
+
+    // Opcodes the instruction selector emits. Branch pseudo-instructions
+    // (blt, bge, ...) are expanded by the assembler.
+    enum class MOpcode : uint8_t
+    {
+        // rd, rs, rt
+        ADDU, SUBU, MUL, AND, OR, XOR, NOR, SLT, SLTU, SLLV, SRLV, SRAV,
+        // rt, rs, imm
+        ADDIU, ANDI, ORI, XORI, SLTI, SLTIU, SLL, SRL, SRA,
+        // rs, rt -> HI/LO
+        MULT, MULTU, DIV, DIVU,
+        // rd
+        MFHI, MFLO,
+        // rd, imm | rd, symbol | rd, rs
+        LI, LA, MOVE,
+        // rt, mem
+        LW, LB, SW, SB,
+        // control flow
+        J, JAL, JR,
+        BEQ, BNE, BLT, BGE, BGT, BLE, // rs, rt, target
+        BEQZ, BNEZ, BLTZ, BLEZ, BGTZ, BGEZ, // rs, target
+        SYSCALL,
+        COMMENT, // symbol operand holds the text
+    };
+
+    struct MachineOpcodeInfo
+    {
+        const char *name;
+        bool definesFirst; // operand 0 is written
+        bool isBranch;     // conditional, last operand is the target
+        bool isJump;       // unconditional transfer (j, jr)
+    };
+    const MachineOpcodeInfo &opcodeInfo(MOpcode op);
+
+    class MachineBasicBlock;
+
+    // Register, immediate, memory ("offset(base)", or "symbol+offset(base)"
+    // for data labels), block label or symbol.
+    struct MOperand
+    {
+        enum class Kind : uint8_t
+        {
+            Reg,
+            Imm,
+            Mem,
+            Block,
+            Symbol,
+        };
+
+        Kind kind = Kind::Imm;
+        int reg = 0;       // Reg, and Mem base
+        int64_t imm = 0;   // Imm, and Mem offset
+        MachineBasicBlock *block = nullptr;
+        std::string symbol; // Symbol, and Mem label if any
+
+        static MOperand preg(PReg r);
+        static MOperand immediate(int64_t v);
+        static MOperand mem(PReg base, int64_t offset);
+        static MOperand mem(std::string label, int64_t offset, PReg base = PReg::ZERO);
+        static MOperand label(MachineBasicBlock *bb);
+        static MOperand sym(std::string name);
+
+        bool isReg() const { return kind == Kind::Reg; }
+        bool isPReg(PReg r) const { return kind == Kind::Reg && reg == (int)r; }
+        PReg preg() const { return (PReg)reg; }
+        bool operator==(const MOperand &o) const;
+        bool operator!=(const MOperand &o) const { return !(*this == o); }
+    };
+
+    struct MachineInstr
+    {
+        MOpcode opcode;
+        std::vector<MOperand> operands;
+
+        MachineInstr(MOpcode op, std::vector<MOperand> ops = {}) : opcode(op), operands(std::move(ops)) {}
+
+        const MachineOpcodeInfo &info() const { return opcodeInfo(opcode); }
+
+        // Register operands read and written, including implicit ones
+        // (syscall reads $v0/$a0 and writes $v0). Returns false for calls,
+        // whose effects are not modelled.
+        bool regEffects(std::vector<MOperand> &uses, std::vector<MOperand> &defs) const;
+    };
+
+    class MachineBasicBlock
+    {
+    public:
+        std::string label;
+        std::list<MachineInstr> instrs;
+
+        explicit MachineBasicBlock(std::string label) : label(std::move(label)) {}
+
+        void append(MOpcode op, std::vector<MOperand> ops = {}) { instrs.emplace_back(op, std::move(ops)); }
+    };
+
+    // Blocks are kept in layout order; the first one carries the function
+    // label and the prologue.
+    class MachineFunction
+    {
+    public:
+        std::string name;
+        std::vector<std::unique_ptr<MachineBasicBlock>> blocks;
+
+        explicit MachineFunction(std::string name) : name(std::move(name)) {}
+
+        MachineBasicBlock *addBlock(std::string label);
+    };
+
+} // namespace backend
@@ -0,0 +1,67 @@
+#include "MarsCost.hpp"
+#include "MachineIR.hpp"
+
+namespace backend
+{
+
+    namespace
+    {
+
+        bool fitsSigned16(int64_t v) { return v >= -32768 && v <= 32767; }
+        bool fitsUnsigned16(int64_t v) { return v >= 0 && v <= 0xffff; }
+
+    } // namespace
+
+    int marsCost(const MachineInstr &mi)
+    {
+        const auto &ops = mi.operands;
+        switch (mi.opcode)
+        {
+        case MOpcode::COMMENT:
+            return 0;
+        case MOpcode::DIV:
+        case MOpcode::DIVU:
+            return kMarsDivCost;
+        case MOpcode::MUL:
+        case MOpcode::MULT:
+        case MOpcode::MULTU:
+            return kMarsMulCost;
+        case MOpcode::LW:
+        case MOpcode::LB:
+        case MOpcode::SW:
+        case MOpcode::SB:
+        {
+            // A label or a large offset costs a lui, plus an addu to add the
+            // base register to it.
+            const MOperand &addr = ops[1];
+            if (addr.kind != MOperand::Kind::Mem)
+                return kMarsMemCost + kMarsOtherCost;
+            if (addr.symbol.empty() && fitsSigned16(addr.imm))
+                return kMarsMemCost;
+            bool hasBase = addr.preg() != PReg::ZERO;
+            return kMarsMemCost + (hasBase ? 2 : 1) * kMarsOtherCost;
+        }
+        case MOpcode::LI:
+        {
+            int64_t v = ops[1].imm;
+            return fitsSigned16(v) || fitsUnsigned16(v) ? kMarsOtherCost : 2 * kMarsOtherCost;
+        }
+        case MOpcode::LA:
+            return 2 * kMarsOtherCost;
+        case MOpcode::ADDIU:
+        case MOpcode::SLTI:
+        case MOpcode::SLTIU:
+            return fitsSigned16(ops[2].imm) ? kMarsOtherCost : 3 * kMarsOtherCost;
+        case MOpcode::ANDI:
+        case MOpcode::ORI:
+        case MOpcode::XORI:
+            return fitsUnsigned16(ops[2].imm) ? kMarsOtherCost : 3 * kMarsOtherCost;
+        default:
+            break;
+        }
+        if (mi.info().isBranch || mi.info().isJump || mi.opcode == MOpcode::JAL)
+            return kMarsBranchCost;
+        return kMarsOtherCost;
+    }
+
+} // namespace backend
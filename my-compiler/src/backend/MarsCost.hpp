@@ -0,0 +1,21 @@
+#pragma once
+
+namespace backend
+{
+
+    struct MachineInstr;
+
+    // Cycle weights MARS uses when scoring a program (see
+    // InstructionStatistics.txt). Instruction selection compares candidate
+    // sequences with these, not with real pipeline latencies.
+    constexpr int kMarsDivCost = 15;
+    constexpr int kMarsMulCost = 5;
+    constexpr int kMarsBranchCost = 2; // jumps and branches
+    constexpr int kMarsMemCost = 3;
+    constexpr int kMarsOtherCost = 1;
+
+    // Weighted cost of one instruction, counting the basic instructions MARS
+    // expands a pseudo-instruction into (e.g. a 32-bit `li` is lui + ori).
+    int marsCost(const MachineInstr &mi);
+
+} // namespace backend
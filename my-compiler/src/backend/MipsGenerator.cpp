@@ -1,26 +1,113 @@
 #include "MipsGenerator.hpp"
+#include "MipsPrinter.hpp"
+#include "ConstMultiply.hpp"
+#include "ConstDivide.hpp"
+#include "Liveness.hpp"
+#include "BlockLayout.hpp"
+#include "../utils/CompileStats.hpp"
 #include <sstream>
 #include <algorithm>
 #include <functional>
 
-MipsGenerator::MipsGenerator(IrModule *module, std::ostream &out)
-    : module(module), out(out) {}
+using backend::MOpcode;
+using backend::MOperand;
+using backend::PReg;
 
-std::string MipsGenerator::makeEdgeLabel(const std::string &base)
+namespace
 {
-    return base + "_phi_edge_" + std::to_string(phiEdgeCounter++);
+    MOperand reg(PReg r) { return MOperand::preg(r); }
+    MOperand imm(int64_t v) { return MOperand::immediate(v); }
+    MOperand mem(PReg base, int64_t offset) { return MOperand::mem(base, offset); }
+
+    // Immediate ranges of addiu/slti/sltiu (sign-extended) and
+    // andi/ori/xori (zero-extended).
+    bool fitsSigned16(int64_t v) { return v >= -32768 && v <= 32767; }
+    bool fitsUnsigned16(int64_t v) { return v >= 0 && v <= 0xffff; }
+
+    // Condition that holds for (b, a) whenever `cond` holds for (a, b).
+    IcmpCond swappedCond(IcmpCond cond)
+    {
+        switch (cond)
+        {
+        case IcmpCond::SGT:
+            return IcmpCond::SLT;
+        case IcmpCond::SGE:
+            return IcmpCond::SLE;
+        case IcmpCond::SLT:
+            return IcmpCond::SGT;
+        case IcmpCond::SLE:
+            return IcmpCond::SGE;
+        default:
+            return cond;
+        }
+    }
+
+    // Contents of an i8 array holding a NUL-terminated string, escaped for
+    // an .asciiz directive; false for anything else.
+    bool asciizText(IrConstant *init, std::string &text)
+    {
+        auto arr = dynamic_cast<IrConstantArray *>(init);
+        if (!arr || arr->elements.empty())
+            return false;
+        text.clear();
+        for (size_t i = 0; i < arr->elements.size(); ++i)
+        {
+            auto ch = dynamic_cast<IrConstantInt *>(arr->elements[i]);
+            if (!ch || !ch->type->isInt8())
+                return false;
+            bool last = i + 1 == arr->elements.size();
+            if ((ch->value == 0) != last)
+                return false;
+            switch (ch->value)
+            {
+            case 0:
+                break;
+            case '\n':
+                text += "\\n";
+                break;
+            case '\t':
+                text += "\\t";
+                break;
+            case '"':
+                text += "\\\"";
+                break;
+            case '\\':
+                text += "\\\\";
+                break;
+            default:
+                if (ch->value < 32 || ch->value > 126)
+                    return false;
+                text += (char)ch->value;
+            }
+        }
+        return true;
+    }
 }
 
+MipsGenerator::MipsGenerator(IrModule *module, std::ostream &out, backend::RegisterAllocator *allocator)
+    : module(module), out(out), allocator(allocator) {}
+
 void MipsGenerator::emitPhiCopies(IrBasicBlock *from, IrBasicBlock *to)
 {
     if (!to)
         return;
 
+    // Values without a register or stack slot (constants, globals, allocas)
+    // are materialized.
+    auto locationOf = [&](IrValue *v) -> backend::CopyLocation
+    {
+        if (auto r = allocatedRegister(v))
+            return backend::CopyLocation::inRegister(*r);
+        if (dynamic_cast<IrConstant *>(v) || dynamic_cast<AllocaInstr *>(v))
+            return {};
+        auto it = stackOffsets.find(v);
+        return it == stackOffsets.end() ? backend::CopyLocation() : backend::CopyLocation::onStack(it->second);
+    };
+
+    std::vector<backend::CopyMove> copies;
     // Phi nodes are expected at the start of the basic block.
     for (auto *instr : to->instructions)
     {
-        if (!instr || instr->instrType != InstrType::PHI)
-            break;
         auto *phi = dynamic_cast<PhiInstr *>(instr);
         if (!phi)
             break;
@@ -29,16 +116,40 @@ void MipsGenerator::emitPhiCopies(IrBasicBlock *from, IrBasicBlock *to)
         if (!incoming)
         {
             // Fallback: treat as 0
-            loadToRegister(IrConstantInt::get(0), T0);
+            incoming = IrConstantInt::get(0);
         }
-        else
+        backend::CopyLocation dst = locationOf(phi);
+        if (!dst.isNone())
+            copies.push_back({dst, locationOf(incoming), incoming});
+    }
+
+    using Kind = backend::CopyLocation::Kind;
+    for (const auto &c : backend::sequentializeCopies(copies, backend::CopyLocation::inRegister(V1)))
+    {
+        bool dstInReg = c.dst.kind == Kind::Reg;
+        PReg dstReg = dstInReg ? c.dst.reg : T8;
+        if (c.src.isNone())
+            loadToRegister(c.value, dstReg);
+        else if (c.src.kind == Kind::Reg)
         {
-            loadToRegister(incoming, T0);
+            if (dstInReg)
+                emit(MOpcode::MOVE, {reg(dstReg), reg(c.src.reg)});
+            else
+                dstReg = c.src.reg;
         }
-        storeFromRegister(phi, T0);
+        else
+            emit(MOpcode::LW, {reg(dstReg), mem(PReg::FP, c.src.offset)});
+        if (!dstInReg)
+            emit(MOpcode::SW, {reg(dstReg), mem(PReg::FP, c.dst.offset)});
     }
 }
 
+void MipsGenerator::emitJump(IrBasicBlock *target)
+{
+    emitPhiCopies(currentBlock, target);
+    emit(MOpcode::J, {MOperand::label(blockMap.at(target))});
+}
+
 void MipsGenerator::generate()
 {
     // Data Segment
@@ -48,7 +159,12 @@ void MipsGenerator::generate()
         std::string name = "_" + gv->name.substr(1); // Strip @ and add _ prefix
         out << name << ":";
 
-        if (auto constArr = dynamic_cast<IrConstantArray *>(gv->initVal))
+        std::string text;
+        if (gv->isConst && asciizText(gv->initVal, text))
+        {
+            out << " .asciiz \"" << text << "\"\n";
+        }
+        else if (auto constArr = dynamic_cast<IrConstantArray *>(gv->initVal))
         {
             // Flatten array
             out << "\n";
@@ -99,6 +215,13 @@ void MipsGenerator::generate()
             continue;
         visitFunction(func);
     }
+
+    if (recordStats)
+    {
+        CompileStats::Record("layout", "jumps removed: " + std::to_string(jumpsRemovedByLayout));
+        for (const auto &[rule, count] : peephole.hitCounts())
+            CompileStats::Record("peephole", rule + ": " + std::to_string(count));
+    }
 }
 
 void MipsGenerator::visitFunction(IrFunction *func)
@@ -106,8 +229,19 @@ void MipsGenerator::visitFunction(IrFunction *func)
     currentFunction = func;
     currentBlock = nullptr;
     stackOffsets.clear();
+    calleeSaveOffsets.clear();
+    blockMap.clear();
     currentStackSize = 0;
-    phiEdgeCounter = 0;
+    backend::splitCriticalEdges(func);
+    assignment = allocator ? allocator->allocate(func) : backend::RegisterAssignment();
+    if (allocator && recordStats)
+    {
+        size_t values = backend::countAllocatableValues(func);
+        size_t spilled = values - assignment.registers.size();
+        CompileStats::Record("regalloc", func->name + ": " + assignment.method + ", " + std::to_string(values) +
+                                             " values, " + std::to_string(spilled) + " spilled, " +
+                                             std::to_string(assignment.usedCalleeSaved.size()) + " callee-saved");
+    }
 
     // Calculate stack layout
     // 1. Saved registers ($ra, $fp)
@@ -124,6 +258,8 @@ void MipsGenerator::visitFunction(IrFunction *func)
         auto arg = func->params[i];
         if (i < 4)
         {
+            if (allocatedRegister(arg))
+                continue;
             localStart += 4;
             stackOffsets[arg] = -localStart;
         }
@@ -134,12 +270,13 @@ void MipsGenerator::visitFunction(IrFunction *func)
         }
     }
 
-    // 3. Instructions (Locals and Temps)
+    // 3. Instructions (Locals and Temps). Values that got a register need no slot.
     for (auto bb : func->blocks)
     {
         for (auto instr : bb->instructions)
         {
-            if (!instr->type->isVoid())
+            if (!instr->type->isVoid() && !allocatedRegister(instr) && !backend::isFusedCompare(instr) &&
+                !backend::isFusedAddress(instr))
             {
                 int size = 4;
                 int align = 4;
@@ -180,33 +317,57 @@ void MipsGenerator::visitFunction(IrFunction *func)
         }
     }
 
+    // 4. Callee-saved registers used by the allocation
+    if (localStart % 4 != 0)
+        localStart += 4 - (localStart % 4);
+    for (PReg r : assignment.usedCalleeSaved)
+    {
+        localStart += 4;
+        calleeSaveOffsets[r] = -localStart;
+    }
+
     // Align stack size to 8 bytes
     if (localStart % 8 != 0)
         localStart += 4;
     currentStackSize = localStart;
 
-    // Emit function label
-    out << getFunctionName(func) << ":\n";
+    // One machine block for the prologue (carrying the function label), then
+    // one per IR block in the same order.
+    machineFunction = std::make_unique<backend::MachineFunction>(getFunctionName(func));
+    currentMBB = machineFunction->addBlock(getFunctionName(func));
+    for (auto bb : func->blocks)
+        blockMap[bb] = machineFunction->addBlock(getLabelName(bb));
 
     // Prologue
-    emit("sw $ra, -4($sp)");
-    emit("sw $fp, -8($sp)");
-    emit("move $fp, $sp");
+    emit(MOpcode::SW, {reg(PReg::RA), mem(PReg::SP, -4)});
+    emit(MOpcode::SW, {reg(PReg::FP), mem(PReg::SP, -8)});
+    emit(MOpcode::MOVE, {reg(PReg::FP), reg(PReg::SP)});
     if (currentStackSize > 32767)
     {
-        emit("li $t0, " + std::to_string(currentStackSize));
-        emit("subu $sp, $sp, $t0");
+        emit(MOpcode::LI, {reg(T8), imm(currentStackSize)});
+        emit(MOpcode::SUBU, {reg(PReg::SP), reg(PReg::SP), reg(T8)});
     }
     else
     {
-        emit("addiu $sp, $sp, -" + std::to_string(currentStackSize));
+        emit(MOpcode::ADDIU, {reg(PReg::SP), reg(PReg::SP), imm(-currentStackSize)});
+    }
+    for (const auto &[r, offset] : calleeSaveOffsets)
+    {
+        emit(MOpcode::SW, {reg(r), mem(PReg::FP, offset)});
     }
 
-    // Save arguments to stack
-    for (size_t i = 0; i < func->params.size() && i < 4; ++i)
+    // Move arguments to their allocated registers or stack slots
+    for (size_t i = 0; i < func->params.size(); ++i)
     {
-        std::string reg = "$a" + std::to_string(i);
-        storeFromRegister(func->params[i], reg);
+        auto r = allocatedRegister(func->params[i]);
+        if (i < 4)
+        {
+            storeFromRegister(func->params[i], (PReg)((int)PReg::A0 + (int)i));
+        }
+        else if (r)
+        {
+            emit(MOpcode::LW, {reg(*r), mem(PReg::FP, (int64_t)(i - 4) * 4)});
+        }
     }
 
     // Visit Blocks
@@ -214,15 +375,24 @@ void MipsGenerator::visitFunction(IrFunction *func)
     {
         visitBasicBlock(bb);
     }
+
+    jumpsRemovedByLayout += backend::layoutBlocks(*machineFunction);
+    peephole.run(*machineFunction);
+    backend::printMachineFunction(*machineFunction, out);
+    machineFunction.reset();
+    currentMBB = nullptr;
 }
 
 void MipsGenerator::visitBasicBlock(IrBasicBlock *bb)
 {
     currentBlock = bb;
-    out << getLabelName(bb) << ":\n";
+    currentMBB = blockMap.at(bb);
     for (auto instr : bb->instructions)
     {
         visitInstr(instr);
+        // Anything after the first terminator is unreachable.
+        if (instr->instrType == InstrType::BR || instr->instrType == InstrType::JUMP || instr->instrType == InstrType::RET)
+            break;
     }
 }
 
@@ -236,45 +406,35 @@ void MipsGenerator::visitInstr(Instr *instr)
     case InstrType::SDIV:
     case InstrType::SREM:
     {
-        loadToRegister(instr->getOperand(0), T0);
-        loadToRegister(instr->getOperand(1), T1);
-        std::string op;
-        switch (instr->instrType)
-        {
-        case InstrType::ADD:
-            op = "addu";
-            break;
-        case InstrType::SUB:
-            op = "subu";
+        if (instr->instrType == InstrType::MUL && lowerConstMultiply(instr))
             break;
-        case InstrType::MUL:
-            op = "mul";
+        if ((instr->instrType == InstrType::SDIV || instr->instrType == InstrType::SREM) && lowerConstDivide(instr))
             break;
-        case InstrType::SDIV:
-            op = "div";
+        if ((instr->instrType == InstrType::ADD || instr->instrType == InstrType::SUB) && lowerAddImmediate(instr))
             break;
-        case InstrType::SREM:
-            op = "div";
-            break;
-        default:
-            break;
-        }
+
+        PReg lhs = useRegister(instr->getOperand(0), T8);
+        PReg rhs = useRegister(instr->getOperand(1), T9);
+        PReg dst = defRegister(instr, T8);
 
         if (instr->instrType == InstrType::SDIV)
         {
-            emit("div " + T0 + ", " + T1);
-            emit("mflo " + T2);
+            emit(MOpcode::DIV, {reg(lhs), reg(rhs)});
+            emit(MOpcode::MFLO, {reg(dst)});
         }
         else if (instr->instrType == InstrType::SREM)
         {
-            emit("div " + T0 + ", " + T1);
-            emit("mfhi " + T2);
+            emit(MOpcode::DIV, {reg(lhs), reg(rhs)});
+            emit(MOpcode::MFHI, {reg(dst)});
         }
         else
         {
-            emit(op + " " + T2 + ", " + T0 + ", " + T1);
+            MOpcode op = instr->instrType == InstrType::ADD   ? MOpcode::ADDU
+                         : instr->instrType == InstrType::SUB ? MOpcode::SUBU
+                                                              : MOpcode::MUL;
+            emit(op, {reg(dst), reg(lhs), reg(rhs)});
         }
-        storeFromRegister(instr, T2);
+        finishDef(instr, dst);
         break;
     }
     case InstrType::ALLOCA:
@@ -288,92 +448,102 @@ void MipsGenerator::visitInstr(Instr *instr)
     }
     case InstrType::LOAD:
     {
-        loadToRegister(instr->getOperand(0), T0); // Load address
-        if (instr->type->isInt8())
-        {
-            emit("lb " + T1 + ", 0(" + T0 + ")");
-        }
-        else
-        {
-            emit("lw " + T1 + ", 0(" + T0 + ")");
-        }
-        storeFromRegister(instr, T1);
+        MOperand addr = memoryOperand(instr->getOperand(0), T8);
+        PReg dst = defRegister(instr, T9);
+        emit(instr->type->isInt8() ? MOpcode::LB : MOpcode::LW, {reg(dst), addr});
+        finishDef(instr, dst);
         break;
     }
     case InstrType::STORE:
     {
-        loadToRegister(instr->getOperand(0), T0); // Value
-        loadToRegister(instr->getOperand(1), T1); // Pointer
-        if (instr->getOperand(0)->type->isInt8())
-        {
-            emit("sb " + T0 + ", 0(" + T1 + ")");
-        }
-        else
-        {
-            emit("sw " + T0 + ", 0(" + T1 + ")");
-        }
+        PReg val = useRegister(instr->getOperand(0), T8);
+        MOperand addr = memoryOperand(instr->getOperand(1), T9);
+        emit(instr->getOperand(0)->type->isInt8() ? MOpcode::SB : MOpcode::SW, {reg(val), addr});
         break;
     }
     case InstrType::ICMP:
     {
+        // Lowered together with the branch that uses it.
+        if (backend::isFusedCompare(instr))
+            break;
+
         auto icmp = dynamic_cast<IcmpInstr *>(instr);
-        loadToRegister(icmp->getOperand(0), T0);
-        loadToRegister(icmp->getOperand(1), T1);
+        IrValue *lhsVal = icmp->getOperand(0);
+        IrValue *rhsVal = icmp->getOperand(1);
+        IcmpCond cond = icmp->cond;
+        // Keep a literal on the right, where the immediate forms take it.
+        if (dynamic_cast<IrConstantInt *>(lhsVal) && !dynamic_cast<IrConstantInt *>(rhsVal))
+        {
+            std::swap(lhsVal, rhsVal);
+            cond = swappedCond(cond);
+        }
+
+        PReg lhs = useRegister(lhsVal, T8);
+        PReg dst = defRegister(instr, T8);
+        auto rhsConst = dynamic_cast<IrConstantInt *>(rhsVal);
+        if (rhsConst && emitCompareImmediate(cond, dst, lhs, rhsConst->value))
+        {
+            finishDef(instr, dst);
+            break;
+        }
+        PReg rhs = useRegister(rhsVal, T9);
 
-        switch (icmp->cond)
+        switch (cond)
         {
         case IcmpCond::EQ:
-            emit("xor " + T2 + ", " + T0 + ", " + T1);
-            emit("sltiu " + T2 + ", " + T2 + ", 1");
+            emit(MOpcode::XOR, {reg(dst), reg(lhs), reg(rhs)});
+            emit(MOpcode::SLTIU, {reg(dst), reg(dst), imm(1)});
             break;
         case IcmpCond::NE:
-            emit("xor " + T2 + ", " + T0 + ", " + T1);
-            emit("sltu " + T2 + ", $zero, " + T2);
+            emit(MOpcode::XOR, {reg(dst), reg(lhs), reg(rhs)});
+            emit(MOpcode::SLTU, {reg(dst), reg(PReg::ZERO), reg(dst)});
             break;
         case IcmpCond::SGT:
-            emit("slt " + T2 + ", " + T1 + ", " + T0);
+            emit(MOpcode::SLT, {reg(dst), reg(rhs), reg(lhs)});
             break;
         case IcmpCond::SGE:
-            emit("slt " + T2 + ", " + T0 + ", " + T1);
-            emit("xori " + T2 + ", " + T2 + ", 1");
+            emit(MOpcode::SLT, {reg(dst), reg(lhs), reg(rhs)});
+            emit(MOpcode::XORI, {reg(dst), reg(dst), imm(1)});
             break;
         case IcmpCond::SLT:
-            emit("slt " + T2 + ", " + T0 + ", " + T1);
+            emit(MOpcode::SLT, {reg(dst), reg(lhs), reg(rhs)});
             break;
         case IcmpCond::SLE:
-            emit("slt " + T2 + ", " + T1 + ", " + T0);
-            emit("xori " + T2 + ", " + T2 + ", 1");
+            emit(MOpcode::SLT, {reg(dst), reg(rhs), reg(lhs)});
+            emit(MOpcode::XORI, {reg(dst), reg(dst), imm(1)});
             break;
         }
-        storeFromRegister(instr, T2);
+        finishDef(instr, dst);
         break;
     }
     case InstrType::BR:
     {
-        loadToRegister(instr->getOperand(0), T0);
         auto *trueBlock = dynamic_cast<IrBasicBlock *>(instr->getOperand(1));
         auto *falseBlock = dynamic_cast<IrBasicBlock *>(instr->getOperand(2));
 
-        std::string edgeTrue = makeEdgeLabel(getLabelName(currentBlock) + "_to_" + getLabelName(trueBlock));
-        std::string edgeFalse = makeEdgeLabel(getLabelName(currentBlock) + "_to_" + getLabelName(falseBlock));
-
-        emit("bne " + T0 + ", $zero, " + edgeTrue);
-        emit("j " + edgeFalse);
-
-        out << edgeTrue << ":\n";
-        emitPhiCopies(currentBlock, trueBlock);
-        emit("j " + getLabelName(trueBlock));
-
-        out << edgeFalse << ":\n";
-        emitPhiCopies(currentBlock, falseBlock);
-        emit("j " + getLabelName(falseBlock));
+        if (trueBlock == falseBlock)
+        {
+            emitJump(trueBlock);
+            break;
+        }
+        // Critical edges into phi blocks were split, so neither target needs
+        // copies on this edge.
+        auto *condInstr = dynamic_cast<Instr *>(instr->getOperand(0));
+        if (condInstr && backend::isFusedCompare(condInstr))
+        {
+            emitCompareBranch(dynamic_cast<IcmpInstr *>(condInstr), blockMap.at(trueBlock));
+        }
+        else
+        {
+            PReg cond = useRegister(instr->getOperand(0), T8);
+            emit(MOpcode::BNEZ, {reg(cond), MOperand::label(blockMap.at(trueBlock))});
+        }
+        emitJump(falseBlock);
         break;
     }
     case InstrType::JUMP:
     {
-        auto *target = dynamic_cast<IrBasicBlock *>(instr->getOperand(0));
-        emitPhiCopies(currentBlock, target);
-        emit("j " + getLabelName(target));
+        emitJump(dynamic_cast<IrBasicBlock *>(instr->getOperand(0)));
         break;
     }
     case InstrType::CALL:
@@ -387,53 +557,57 @@ void MipsGenerator::visitInstr(Instr *instr)
             stackArgs = argCount - 4;
         if (stackArgs > 0)
         {
-            emit("addiu $sp, $sp, -" + std::to_string(stackArgs * 4));
+            emit(MOpcode::ADDIU, {reg(PReg::SP), reg(PReg::SP), imm(-stackArgs * 4)});
         }
 
         for (int i = 0; i < argCount; ++i)
         {
-            loadToRegister(instr->getOperand(i + 1), T0);
             if (i < 4)
             {
-                emit("move $a" + std::to_string(i) + ", " + T0);
+                loadToRegister(instr->getOperand(i + 1), (PReg)((int)PReg::A0 + i));
             }
             else
             {
-                emit("sw " + T0 + ", " + std::to_string((i - 4) * 4) + "($sp)");
+                PReg val = useRegister(instr->getOperand(i + 1), T8);
+                emit(MOpcode::SW, {reg(val), mem(PReg::SP, (i - 4) * 4)});
             }
         }
 
         auto func = dynamic_cast<IrFunction *>(instr->getOperand(0));
-        std::string funcName = getFunctionName(func);
 
         if (func->name == "@getint")
         {
-            emit("li $v0, 5");
-            emit("syscall");
+            emit(MOpcode::LI, {reg(PReg::V0), imm(5)});
+            emit(MOpcode::SYSCALL);
         }
         else if (func->name == "@putint")
         {
-            emit("li $v0, 1");
-            emit("syscall");
+            emit(MOpcode::LI, {reg(PReg::V0), imm(1)});
+            emit(MOpcode::SYSCALL);
         }
         else if (func->name == "@putch")
         {
-            emit("li $v0, 11");
-            emit("syscall");
+            emit(MOpcode::LI, {reg(PReg::V0), imm(11)});
+            emit(MOpcode::SYSCALL);
+        }
+        else if (func->name == "@putstr")
+        {
+            emit(MOpcode::LI, {reg(PReg::V0), imm(4)});
+            emit(MOpcode::SYSCALL);
         }
         else
         {
-            emit("jal " + funcName);
+            emit(MOpcode::JAL, {MOperand::sym(getFunctionName(func))});
         }
 
         if (stackArgs > 0)
         {
-            emit("addiu $sp, $sp, " + std::to_string(stackArgs * 4));
+            emit(MOpcode::ADDIU, {reg(PReg::SP), reg(PReg::SP), imm(stackArgs * 4)});
         }
 
         if (!instr->type->isVoid())
         {
-            storeFromRegister(instr, V0);
+            storeFromRegister(instr, PReg::V0);
         }
         break;
     }
@@ -441,18 +615,45 @@ void MipsGenerator::visitInstr(Instr *instr)
     {
         if (instr->operandList.size() > 0)
         {
-            loadToRegister(instr->getOperand(0), V0);
+            loadToRegister(instr->getOperand(0), PReg::V0);
         }
-        // Epilogue
-        emit("move $sp, $fp");
-        emit("lw $ra, -4($sp)");
-        emit("lw $fp, -8($sp)");
-        emit("jr $ra");
+        emitEpilogue();
         break;
     }
     case InstrType::GEP:
     {
-        loadToRegister(instr->getOperand(0), T0); // Base pointer
+        // Folded into the load or store that uses it.
+        if (backend::isFusedAddress(instr))
+            break;
+
+        // A constant offset into a global is just a label; one la does it.
+        if (auto gv = dynamic_cast<IrGlobalValue *>(instr->getOperand(0)))
+        {
+            IrType *type = gv->type;
+            int64_t offset = 0;
+            bool constant = true;
+            for (size_t i = 1; i < instr->operandList.size() && constant; ++i)
+            {
+                if (type->isPointer())
+                    type = dynamic_cast<IrPointerType *>(type)->pointedType;
+                else if (type->isArray())
+                    type = dynamic_cast<IrArrayType *>(type)->elementType;
+                auto constIndex = dynamic_cast<IrConstantInt *>(instr->getOperand(i));
+                constant = constIndex != nullptr;
+                if (constant)
+                    offset += (int64_t)constIndex->value * getSize(type);
+            }
+            if (constant)
+            {
+                PReg dst = defRegister(instr, T8);
+                emit(MOpcode::LA, {reg(dst), MOperand::mem("_" + gv->name.substr(1), offset)});
+                finishDef(instr, dst);
+                break;
+            }
+        }
+
+        PReg addr = useRegister(instr->getOperand(0), T8); // Base pointer
+        PReg dst = defRegister(instr, T8);
 
         IrType *curType = instr->getOperand(0)->type;
         if (curType->isPointer())
@@ -465,85 +666,482 @@ void MipsGenerator::visitInstr(Instr *instr)
             IrValue *index = instr->getOperand(i);
             int elementSize = getSize(curType);
 
-            loadToRegister(index, T1);
-            emit("li " + T2 + ", " + std::to_string(elementSize));
-            emit("mul " + T1 + ", " + T1 + ", " + T2);
-            emit("addu " + T0 + ", " + T0 + ", " + T1);
+            // Partial sums go to $t8; the last one lands in the result register.
+            PReg sum = (i + 1 == instr->operandList.size()) ? dst : T8;
+            if (auto constIndex = dynamic_cast<IrConstantInt *>(index))
+            {
+                int offset = (int)((uint32_t)constIndex->value * (uint32_t)elementSize);
+                if (offset == 0)
+                {
+                    // Nothing to add; the sum is still `addr`.
+                }
+                else if (offset >= -32768 && offset <= 32767)
+                {
+                    emit(MOpcode::ADDIU, {reg(sum), reg(addr), imm(offset)});
+                    addr = sum;
+                }
+                else
+                {
+                    emit(MOpcode::LI, {reg(T9), imm(offset)});
+                    emit(MOpcode::ADDU, {reg(sum), reg(addr), reg(T9)});
+                    addr = sum;
+                }
+            }
+            else
+            {
+                // Scale into $t9 without touching the base address.
+                PReg idx = useRegister(index, T9);
+                std::vector<PReg> scratch;
+                for (PReg r : {T9, V1, T8})
+                {
+                    if (r != idx && r != addr)
+                        scratch.push_back(r);
+                }
+                if (!emitMulByConstant(T9, idx, elementSize, scratch))
+                {
+                    emit(MOpcode::LI, {reg(V1), imm(elementSize)});
+                    emit(MOpcode::MUL, {reg(T9), reg(idx), reg(V1)});
+                }
+                emit(MOpcode::ADDU, {reg(sum), reg(addr), reg(T9)});
+                addr = sum;
+            }
 
             if (curType->isArray())
             {
                 curType = dynamic_cast<IrArrayType *>(curType)->elementType;
             }
         }
-        storeFromRegister(instr, T0);
+        if (addr != dst)
+            emit(MOpcode::MOVE, {reg(dst), reg(addr)});
+        finishDef(instr, dst);
         break;
     }
     case InstrType::ZEXT:
     {
-        loadToRegister(instr->getOperand(0), T0);
-        storeFromRegister(instr, T0);
+        PReg src = useRegister(instr->getOperand(0), T8);
+        PReg dst = defRegister(instr, T8);
+        if (src != dst)
+            emit(MOpcode::MOVE, {reg(dst), reg(src)});
+        finishDef(instr, dst);
         break;
     }
     case InstrType::TRUNC:
     {
-        loadToRegister(instr->getOperand(0), T0);
+        PReg src = useRegister(instr->getOperand(0), T8);
+        PReg dst = defRegister(instr, T8);
         if (instr->type->isInt1())
         {
-            emit("andi " + T0 + ", " + T0 + ", 1");
+            emit(MOpcode::ANDI, {reg(dst), reg(src), imm(1)});
         }
-        storeFromRegister(instr, T0);
+        else if (src != dst)
+        {
+            emit(MOpcode::MOVE, {reg(dst), reg(src)});
+        }
+        finishDef(instr, dst);
         break;
     }
     default:
-        out << "# Unknown instr\n";
+        emit(MOpcode::COMMENT, {MOperand::sym("Unknown instr")});
         break;
     }
 }
 
-void MipsGenerator::emit(std::string instr)
+// Memory operand for the location `ptr` points to. Frame slots, globals and
+// fused GEPs fold into the offset or label; whatever part of the address
+// needs computing goes to `scratch`, with $v1 as a second temporary.
+MOperand MipsGenerator::memoryOperand(IrValue *ptr, PReg scratch)
 {
-    out << "    " << instr << "\n";
+    IrValue *base = ptr;
+    int64_t offset = 0;
+    IrValue *index = nullptr; // variable index, scaled by indexScale
+    int indexScale = 0;
+
+    auto *gep = dynamic_cast<Instr *>(ptr);
+    if (gep && gep->instrType == InstrType::GEP && backend::isFusedAddress(gep))
+    {
+        base = gep->getOperand(0);
+        IrType *curType = dynamic_cast<IrPointerType *>(base->type)->pointedType;
+        for (size_t i = 1; i < gep->operandList.size(); ++i)
+        {
+            int elementSize = getSize(curType);
+            if (auto constIndex = dynamic_cast<IrConstantInt *>(gep->getOperand((int)i)))
+            {
+                offset += (int64_t)constIndex->value * elementSize;
+            }
+            else
+            {
+                index = gep->getOperand((int)i);
+                indexScale = elementSize;
+            }
+            if (curType->isArray())
+                curType = dynamic_cast<IrArrayType *>(curType)->elementType;
+        }
+    }
+
+    auto *global = dynamic_cast<IrGlobalValue *>(base);
+    auto *alloca = dynamic_cast<AllocaInstr *>(base);
+    if (alloca)
+        offset += stackOffsets[alloca];
+    // Address arithmetic wraps like the GEP it replaces.
+    offset = (int32_t)offset;
+
+    PReg addr = PReg::ZERO; // register part of the address, if any
+    if (index)
+    {
+        PReg idx = useRegister(index, scratch);
+        std::vector<PReg> pool = {scratch, V1};
+        pool.erase(std::remove(pool.begin(), pool.end(), idx), pool.end());
+        if (!emitMulByConstant(scratch, idx, indexScale, pool))
+        {
+            emit(MOpcode::LI, {reg(V1), imm(indexScale)});
+            emit(MOpcode::MUL, {reg(scratch), reg(idx), reg(V1)});
+        }
+        addr = scratch;
+        if (alloca)
+        {
+            emit(MOpcode::ADDU, {reg(scratch), reg(scratch), reg(PReg::FP)});
+        }
+        else if (!global)
+        {
+            PReg b = useRegister(base, V1);
+            emit(MOpcode::ADDU, {reg(scratch), reg(b), reg(scratch)});
+        }
+    }
+    else if (alloca)
+    {
+        addr = PReg::FP;
+    }
+    else if (!global)
+    {
+        addr = useRegister(base, scratch);
+    }
+
+    if (global)
+        return MOperand::mem("_" + global->name.substr(1), offset, addr);
+    if (!fitsSigned16(offset))
+    {
+        emit(MOpcode::LI, {reg(V1), imm(offset)});
+        emit(MOpcode::ADDU, {reg(scratch), reg(addr), reg(V1)});
+        return mem(scratch, 0);
+    }
+    return mem(addr, offset);
+}
+
+// Lowers add/sub with a literal that fits addiu; subtracting c is adding -c.
+// Returns false (emitting nothing) otherwise.
+bool MipsGenerator::lowerAddImmediate(Instr *instr)
+{
+    IrValue *lhsVal = instr->getOperand(0);
+    IrValue *rhsVal = instr->getOperand(1);
+    auto lhsConst = dynamic_cast<IrConstantInt *>(lhsVal);
+    auto rhsConst = dynamic_cast<IrConstantInt *>(rhsVal);
+    bool isSub = instr->instrType == InstrType::SUB;
+
+    if (lhsConst && rhsConst)
+    {
+        uint32_t a = (uint32_t)lhsConst->value;
+        uint32_t b = (uint32_t)rhsConst->value;
+        PReg dst = defRegister(instr, T8);
+        emit(MOpcode::LI, {reg(dst), imm((int32_t)(isSub ? a - b : a + b))});
+        finishDef(instr, dst);
+        return true;
+    }
+
+    IrValue *other;
+    int64_t k;
+    if (rhsConst)
+    {
+        other = lhsVal;
+        k = isSub ? -(int64_t)rhsConst->value : rhsConst->value;
+    }
+    else if (lhsConst && !isSub)
+    {
+        other = rhsVal;
+        k = lhsConst->value;
+    }
+    else
+    {
+        return false;
+    }
+    if (!fitsSigned16(k))
+        return false;
+
+    PReg src = useRegister(other, T8);
+    PReg dst = defRegister(instr, T8);
+    if (k != 0)
+        emit(MOpcode::ADDIU, {reg(dst), reg(src), imm(k)});
+    else if (src != dst)
+        emit(MOpcode::MOVE, {reg(dst), reg(src)});
+    finishDef(instr, dst);
+    return true;
+}
+
+// dst = (lhs <cond> c) using slti/sltiu/xori/addiu. Returns false (emitting
+// nothing) if c does not fit the immediate field the condition needs.
+bool MipsGenerator::emitCompareImmediate(IcmpCond cond, PReg dst, PReg lhs, int c)
+{
+    switch (cond)
+    {
+    case IcmpCond::EQ:
+    case IcmpCond::NE:
+    {
+        // Reduce to a test against zero.
+        PReg diff = lhs;
+        if (c != 0)
+        {
+            if (fitsUnsigned16(c))
+                emit(MOpcode::XORI, {reg(dst), reg(lhs), imm(c)});
+            else if (fitsSigned16(-(int64_t)c))
+                emit(MOpcode::ADDIU, {reg(dst), reg(lhs), imm(-(int64_t)c)});
+            else
+                return false;
+            diff = dst;
+        }
+        if (cond == IcmpCond::EQ)
+            emit(MOpcode::SLTIU, {reg(dst), reg(diff), imm(1)});
+        else
+            emit(MOpcode::SLTU, {reg(dst), reg(PReg::ZERO), reg(diff)});
+        return true;
+    }
+    case IcmpCond::SLT:
+    case IcmpCond::SGE:
+        // x >= c is !(x < c).
+        if (!fitsSigned16(c))
+            return false;
+        emit(MOpcode::SLTI, {reg(dst), reg(lhs), imm(c)});
+        break;
+    case IcmpCond::SLE:
+    case IcmpCond::SGT:
+        // x <= c is x < c + 1, and x > c is !(x < c + 1).
+        if (!fitsSigned16((int64_t)c + 1))
+            return false;
+        emit(MOpcode::SLTI, {reg(dst), reg(lhs), imm((int64_t)c + 1)});
+        break;
+    }
+    if (cond == IcmpCond::SGE || cond == IcmpCond::SGT)
+        emit(MOpcode::XORI, {reg(dst), reg(dst), imm(1)});
+    return true;
 }
 
-void MipsGenerator::loadToRegister(IrValue *val, std::string reg)
+// Branches to `target` if the comparison holds, without materializing it.
+void MipsGenerator::emitCompareBranch(IcmpInstr *icmp, backend::MachineBasicBlock *target)
+{
+    IrValue *lhsVal = icmp->getOperand(0);
+    IrValue *rhsVal = icmp->getOperand(1);
+    IcmpCond cond = icmp->cond;
+    if (dynamic_cast<IrConstantInt *>(lhsVal) && !dynamic_cast<IrConstantInt *>(rhsVal))
+    {
+        std::swap(lhsVal, rhsVal);
+        cond = swappedCond(cond);
+    }
+    PReg lhs = useRegister(lhsVal, T8);
+    MOperand label = MOperand::label(target);
+    auto rhsConst = dynamic_cast<IrConstantInt *>(rhsVal);
+
+    if (rhsConst && rhsConst->value == 0)
+    {
+        static const std::map<IcmpCond, MOpcode> zeroForms = {
+            {IcmpCond::EQ, MOpcode::BEQZ}, {IcmpCond::NE, MOpcode::BNEZ}, {IcmpCond::SLT, MOpcode::BLTZ},
+            {IcmpCond::SGE, MOpcode::BGEZ}, {IcmpCond::SGT, MOpcode::BGTZ}, {IcmpCond::SLE, MOpcode::BLEZ}};
+        emit(zeroForms.at(cond), {reg(lhs), label});
+        return;
+    }
+
+    if (rhsConst && cond != IcmpCond::EQ && cond != IcmpCond::NE)
+    {
+        // x < c and x >= c test slti c; x <= c and x > c test slti c + 1.
+        bool strict = cond == IcmpCond::SLT || cond == IcmpCond::SGE;
+        int64_t k = strict ? (int64_t)rhsConst->value : (int64_t)rhsConst->value + 1;
+        if (fitsSigned16(k))
+        {
+            emit(MOpcode::SLTI, {reg(T9), reg(lhs), imm(k)});
+            bool below = cond == IcmpCond::SLT || cond == IcmpCond::SLE;
+            emit(below ? MOpcode::BNEZ : MOpcode::BEQZ, {reg(T9), label});
+            return;
+        }
+    }
+
+    static const std::map<IcmpCond, MOpcode> regForms = {
+        {IcmpCond::EQ, MOpcode::BEQ}, {IcmpCond::NE, MOpcode::BNE}, {IcmpCond::SLT, MOpcode::BLT},
+        {IcmpCond::SGE, MOpcode::BGE}, {IcmpCond::SGT, MOpcode::BGT}, {IcmpCond::SLE, MOpcode::BLE}};
+    PReg rhs = useRegister(rhsVal, T9);
+    emit(regForms.at(cond), {reg(lhs), reg(rhs), label});
+}
+
+// Lowers `mul` with a constant operand. Returns false (emitting nothing) if
+// neither operand is a constant.
+bool MipsGenerator::lowerConstMultiply(Instr *instr)
+{
+    auto lhsConst = dynamic_cast<IrConstantInt *>(instr->getOperand(0));
+    auto rhsConst = dynamic_cast<IrConstantInt *>(instr->getOperand(1));
+    if (!lhsConst && !rhsConst)
+        return false;
+
+    if (lhsConst && rhsConst)
+    {
+        PReg dst = defRegister(instr, T8);
+        emit(MOpcode::LI, {reg(dst), imm((int)((uint32_t)lhsConst->value * (uint32_t)rhsConst->value))});
+        finishDef(instr, dst);
+        return true;
+    }
+
+    int c = rhsConst ? rhsConst->value : lhsConst->value;
+    PReg src = useRegister(instr->getOperand(rhsConst ? 0 : 1), T8);
+    PReg dst = defRegister(instr, T8);
+    std::vector<PReg> scratch = {T9, V1};
+    if (src != T8)
+        scratch.push_back(T8);
+    if (!emitMulByConstant(dst, src, c, scratch))
+    {
+        emit(MOpcode::LI, {reg(T9), imm(c)});
+        emit(MOpcode::MUL, {reg(dst), reg(src), reg(T9)});
+    }
+    finishDef(instr, dst);
+    return true;
+}
+
+// Lowers sdiv/srem by a constant divisor without a div when that is cheaper.
+// Returns false (emitting nothing) otherwise.
+bool MipsGenerator::lowerConstDivide(Instr *instr)
+{
+    auto divisor = dynamic_cast<IrConstantInt *>(instr->getOperand(1));
+    if (!divisor)
+        return false;
+
+    PReg n = useRegister(instr->getOperand(0), T8);
+    PReg dst = defRegister(instr, T8);
+    std::vector<PReg> scratch = {T9, V1};
+    if (n != T8)
+        scratch.push_back(T8);
+    std::vector<backend::MachineInstr> seq;
+    if (backend::expandConstDivide(seq, dst, n, divisor->value, instr->instrType == InstrType::SREM, scratch))
+    {
+        emitSequence(seq);
+    }
+    else
+    {
+        emit(MOpcode::LI, {reg(T9), imm(divisor->value)});
+        emit(MOpcode::DIV, {reg(n), reg(T9)});
+        emit(instr->instrType == InstrType::SREM ? MOpcode::MFHI : MOpcode::MFLO, {reg(dst)});
+    }
+    finishDef(instr, dst);
+    return true;
+}
+
+bool MipsGenerator::emitMulByConstant(PReg dst, PReg src, int c, const std::vector<PReg> &scratch)
+{
+    std::vector<backend::MachineInstr> seq;
+    if (!backend::expandConstMultiply(seq, dst, src, c, scratch))
+        return false;
+    emitSequence(seq);
+    return true;
+}
+
+void MipsGenerator::emitEpilogue()
+{
+    for (const auto &[r, offset] : calleeSaveOffsets)
+    {
+        emit(MOpcode::LW, {reg(r), mem(PReg::FP, offset)});
+    }
+    emit(MOpcode::MOVE, {reg(PReg::SP), reg(PReg::FP)});
+    emit(MOpcode::LW, {reg(PReg::RA), mem(PReg::SP, -4)});
+    emit(MOpcode::LW, {reg(PReg::FP), mem(PReg::SP, -8)});
+    emit(MOpcode::JR, {reg(PReg::RA)});
+}
+
+void MipsGenerator::emit(MOpcode op, std::vector<MOperand> ops)
+{
+    currentMBB->append(op, std::move(ops));
+}
+
+void MipsGenerator::emitSequence(std::vector<backend::MachineInstr> &seq)
+{
+    for (auto &mi : seq)
+        currentMBB->instrs.push_back(std::move(mi));
+}
+
+void MipsGenerator::loadToRegister(IrValue *val, PReg r)
 {
     if (auto constInt = dynamic_cast<IrConstantInt *>(val))
     {
-        emit("li " + reg + ", " + std::to_string(constInt->value));
+        emit(MOpcode::LI, {reg(r), imm(constInt->value)});
     }
     else if (auto gv = dynamic_cast<IrGlobalValue *>(val))
     {
-        std::string name = "_" + gv->name.substr(1);
-        emit("la " + reg + ", " + name);
+        emit(MOpcode::LA, {reg(r), MOperand::sym("_" + gv->name.substr(1))});
     }
     else if (auto allocaInstr = dynamic_cast<AllocaInstr *>(val))
     {
         int offset = stackOffsets[allocaInstr];
-        emit("addiu " + reg + ", $fp, " + std::to_string(offset));
+        emit(MOpcode::ADDIU, {reg(r), reg(PReg::FP), imm(offset)});
+    }
+    else if (auto allocated = allocatedRegister(val))
+    {
+        if (*allocated != r)
+            emit(MOpcode::MOVE, {reg(r), reg(*allocated)});
     }
     else
     {
         if (stackOffsets.find(val) != stackOffsets.end())
         {
             int offset = stackOffsets[val];
-            emit("lw " + reg + ", " + std::to_string(offset) + "($fp)");
+            emit(MOpcode::LW, {reg(r), mem(PReg::FP, offset)});
         }
         else
         {
-            emit("# Error: Value not found in stack map: " + val->name);
+            emit(MOpcode::COMMENT, {MOperand::sym("Error: Value not found in stack map: " + val->name)});
         }
     }
 }
 
-void MipsGenerator::storeFromRegister(IrValue *val, std::string reg)
+void MipsGenerator::storeFromRegister(IrValue *val, PReg r)
 {
-    if (stackOffsets.find(val) != stackOffsets.end())
+    if (auto allocated = allocatedRegister(val))
+    {
+        if (*allocated != r)
+            emit(MOpcode::MOVE, {reg(*allocated), reg(r)});
+    }
+    else if (stackOffsets.find(val) != stackOffsets.end())
     {
         int offset = stackOffsets[val];
-        emit("sw " + reg + ", " + std::to_string(offset) + "($fp)");
+        emit(MOpcode::SW, {reg(r), mem(PReg::FP, offset)});
     }
 }
 
+std::optional<PReg> MipsGenerator::allocatedRegister(IrValue *val) const
+{
+    auto it = assignment.registers.find(val);
+    if (it == assignment.registers.end())
+        return std::nullopt;
+    return it->second;
+}
+
+// Register holding `val` for reading: its allocated register, $zero for the
+// literal 0, or `scratch` after materializing/reloading it there.
+PReg MipsGenerator::useRegister(IrValue *val, PReg scratch)
+{
+    if (auto constInt = dynamic_cast<IrConstantInt *>(val); constInt && constInt->value == 0)
+        return PReg::ZERO;
+    if (auto allocated = allocatedRegister(val))
+        return *allocated;
+    loadToRegister(val, scratch);
+    return scratch;
+}
+
+// Register an instruction should write its result to; finishDef spills it
+// afterwards if the value has no register.
+PReg MipsGenerator::defRegister(IrValue *val, PReg scratch)
+{
+    auto allocated = allocatedRegister(val);
+    return allocated ? *allocated : scratch;
+}
+
+void MipsGenerator::finishDef(IrValue *val, PReg r)
+{
+    if (!allocatedRegister(val))
+        storeFromRegister(val, r);
+}
+
 int MipsGenerator::getSize(IrType *type)
 {
     if (type->isInt32())
@@ -21,59 +21,85 @@
 #include "../midend/llvm/type/IrBaseType.hpp"
 #include "../midend/llvm/type/IrPointerType.hpp"
 #include "../midend/llvm/type/IrArrayType.hpp"
+#include "RegisterAllocator.hpp"
+#include "OutOfSsa.hpp"
+#include "MachineIR.hpp"
+#include "Peephole.hpp"
 
 #include <iostream>
 #include <map>
+#include <memory>
+#include <optional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+// Instruction selection: lowers each IrFunction into a
+// backend::MachineFunction, runs the machine-level peephole pass over it and
+// prints it with backend::printMachineFunction.
 class MipsGenerator
 {
 public:
-    MipsGenerator(IrModule *module, std::ostream &out);
+    // Without an allocator every SSA value lives in its own stack slot.
+    MipsGenerator(IrModule *module, std::ostream &out, backend::RegisterAllocator *allocator = nullptr);
     void generate();
+    // enable/disable recording allocator and peephole numbers in CompileStats
+    void setRecordStats(bool v) { recordStats = v; }
 
 private:
+    using PReg = backend::PReg;
+
     IrModule *module;
     std::ostream &out;
+    backend::RegisterAllocator *allocator;
+    bool recordStats = true;
+    backend::PeepholeOptimizer peephole;
+    int jumpsRemovedByLayout = 0;
 
     // Current function context
     IrFunction *currentFunction;
     IrBasicBlock *currentBlock;
+    std::unique_ptr<backend::MachineFunction> machineFunction;
+    backend::MachineBasicBlock *currentMBB = nullptr;
+    std::map<IrBasicBlock *, backend::MachineBasicBlock *> blockMap;
     std::map<IrValue *, int> stackOffsets; // Offset from FP
     int currentStackSize;
-    int phiEdgeCounter = 0;
+    backend::RegisterAssignment assignment;
+    std::map<PReg, int> calleeSaveOffsets; // $sN -> offset from FP
 
     void visitFunction(IrFunction *func);
     void visitBasicBlock(IrBasicBlock *bb);
     void visitInstr(Instr *instr);
 
+    // Parallel copy for the phis of `to` along the edge from `from`. Edges
+    // into phi blocks leave single-successor blocks (see
+    // backend::splitCriticalEdges), so the copies go right before the jump.
     void emitPhiCopies(IrBasicBlock *from, IrBasicBlock *to);
-    std::string makeEdgeLabel(const std::string &base);
+    void emitJump(IrBasicBlock *target);
+    void emitCompareBranch(IcmpInstr *icmp, backend::MachineBasicBlock *target);
 
     // Helpers
-    void emit(std::string instr);
-    void emitLabel(std::string label);
-    void loadToRegister(IrValue *val, std::string reg);
-    void storeFromRegister(IrValue *val, std::string reg);
-    int getStackOffset(IrValue *val);
+    void emit(backend::MOpcode op, std::vector<backend::MOperand> ops = {});
+    void emitSequence(std::vector<backend::MachineInstr> &seq);
+    void loadToRegister(IrValue *val, PReg reg);
+    void storeFromRegister(IrValue *val, PReg reg);
+    std::optional<PReg> allocatedRegister(IrValue *val) const;
+    PReg useRegister(IrValue *val, PReg scratch);
+    PReg defRegister(IrValue *val, PReg scratch);
+    void finishDef(IrValue *val, PReg reg);
+    void emitEpilogue();
+    backend::MOperand memoryOperand(IrValue *ptr, PReg scratch);
+    bool lowerAddImmediate(Instr *instr);
+    bool emitCompareImmediate(IcmpCond cond, PReg dst, PReg lhs, int c);
+    bool lowerConstMultiply(Instr *instr);
+    bool lowerConstDivide(Instr *instr);
+    bool emitMulByConstant(PReg dst, PReg src, int c, const std::vector<PReg> &scratch);
     int getSize(IrType *type);
     std::string getLabelName(IrBasicBlock *bb);
     std::string getFunctionName(IrFunction *func);
 
-    // Register names
-    const std::string ZERO = "$zero";
-    const std::string SP = "$sp";
-    const std::string FP = "$fp";
-    const std::string RA = "$ra";
-    const std::string V0 = "$v0";
-    const std::string A0 = "$a0";
-    const std::string A1 = "$a1";
-    const std::string A2 = "$a2";
-    const std::string A3 = "$a3";
-    const std::string T0 = "$t0";
-    const std::string T1 = "$t1";
-    const std::string T2 = "$t2";
-    const std::string T3 = "$t3";
-    const std::string T4 = "$t4";
+    // Scratch registers, never handed out by the register allocators.
+    static constexpr PReg T8 = PReg::T8;
+    static constexpr PReg T9 = PReg::T9;
+    static constexpr PReg V1 = PReg::V1;
 };
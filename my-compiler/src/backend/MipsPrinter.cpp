@@ -0,0 +1,54 @@
+#include "MipsPrinter.hpp"
+
+namespace backend
+{
+
+    std::string formatOperand(const MOperand &op)
+    {
+        switch (op.kind)
+        {
+        case MOperand::Kind::Reg:
+            return pregName(op.preg());
+        case MOperand::Kind::Imm:
+            return std::to_string(op.imm);
+        case MOperand::Kind::Mem:
+        {
+            std::string base = pregName(op.preg());
+            if (op.symbol.empty())
+                return std::to_string(op.imm) + "(" + base + ")";
+            std::string s = op.symbol;
+            if (op.imm != 0)
+                s += (op.imm > 0 ? "+" : "") + std::to_string(op.imm);
+            if (op.preg() != PReg::ZERO)
+                s += "(" + base + ")";
+            return s;
+        }
+        case MOperand::Kind::Block:
+            return op.block ? op.block->label : "";
+        case MOperand::Kind::Symbol:
+            return op.symbol;
+        }
+        return "";
+    }
+
+    std::string formatInstr(const MachineInstr &mi)
+    {
+        if (mi.opcode == MOpcode::COMMENT)
+            return "# " + (mi.operands.empty() ? std::string() : mi.operands[0].symbol);
+        std::string s = mi.info().name;
+        for (size_t i = 0; i < mi.operands.size(); ++i)
+            s += (i == 0 ? " " : ", ") + formatOperand(mi.operands[i]);
+        return s;
+    }
+
+    void printMachineFunction(const MachineFunction &mf, std::ostream &out)
+    {
+        for (const auto &bb : mf.blocks)
+        {
+            out << bb->label << ":\n";
+            for (const auto &mi : bb->instrs)
+                out << "    " << formatInstr(mi) << "\n";
+        }
+    }
+
+} // namespace backend
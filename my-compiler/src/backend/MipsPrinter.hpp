@@ -0,0 +1,17 @@
+#pragma once
+
+#include "MachineIR.hpp"
+
+#include <iostream>
+#include <string>
+
+namespace backend
+{
+
+    // Renders machine IR as MARS assembly: block labels flush left,
+    // instructions indented by four spaces.
+    std::string formatOperand(const MOperand &op);
+    std::string formatInstr(const MachineInstr &mi);
+    void printMachineFunction(const MachineFunction &mf, std::ostream &out);
+
+} // namespace backend
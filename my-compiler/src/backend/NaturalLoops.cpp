@@ -0,0 +1,73 @@
+#include "NaturalLoops.hpp"
+
+#include <cstddef>
+#include <unordered_map>
+#include <utility>
+
+namespace backend
+{
+
+    std::vector<NaturalLoop> findNaturalLoops(const std::vector<std::vector<int>> &succ,
+                                              const std::vector<std::vector<int>> &pred)
+    {
+        const int n = (int)succ.size();
+        std::vector<NaturalLoop> loops;
+        if (n == 0)
+            return loops;
+
+        std::vector<int> state(n, 0);        // 0 new, 1 on stack, 2 done
+        std::unordered_map<int, int> loopOf; // header -> loop
+        std::vector<std::pair<int, size_t>> stack = {{0, 0}};
+        state[0] = 1;
+        while (!stack.empty())
+        {
+            auto &[b, next] = stack.back();
+            if (next == succ[b].size())
+            {
+                state[b] = 2;
+                stack.pop_back();
+                continue;
+            }
+            int s = succ[b][next++];
+            if (state[s] == 0)
+            {
+                state[s] = 1;
+                stack.push_back({s, 0});
+            }
+            else if (state[s] == 1)
+            {
+                // Back edge b -> s: the loop is everything that reaches b
+                // without passing through s.
+                int latch = b;
+                if (!loopOf.count(s))
+                {
+                    loopOf[s] = (int)loops.size();
+                    loops.push_back({s, std::vector<bool>(n, false)});
+                    loops.back().body[s] = true;
+                }
+                auto &body = loops[loopOf[s]].body;
+                std::vector<int> work;
+                if (!body[latch])
+                {
+                    body[latch] = true;
+                    work.push_back(latch);
+                }
+                while (!work.empty())
+                {
+                    int x = work.back();
+                    work.pop_back();
+                    for (int p : pred[x])
+                    {
+                        if (!body[p])
+                        {
+                            body[p] = true;
+                            work.push_back(p);
+                        }
+                    }
+                }
+            }
+        }
+        return loops;
+    }
+
+} // namespace backend
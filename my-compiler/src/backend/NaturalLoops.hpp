@@ -0,0 +1,22 @@
+#pragma once
+
+#include <vector>
+
+namespace backend
+{
+
+    // A natural loop of a CFG whose blocks are numbered 0..n-1, entry 0.
+    struct NaturalLoop
+    {
+        int header;
+        std::vector<bool> body; // [block], header included
+    };
+
+    // Natural loops from the back edges of a DFS from the entry. SysY control
+    // flow is structured, so the CFG is reducible and every DFS back edge
+    // targets a loop header. Loops sharing a header are merged, so each
+    // header contributes one level of nesting.
+    std::vector<NaturalLoop> findNaturalLoops(const std::vector<std::vector<int>> &succ,
+                                              const std::vector<std::vector<int>> &pred);
+
+} // namespace backend
@@ -0,0 +1,131 @@
+#include "OutOfSsa.hpp"
+#include "Liveness.hpp"
+
+#include "../midend/llvm/value/IrFunction.hpp"
+#include "../midend/llvm/value/IrBasicBlock.hpp"
+#include "../midend/llvm/instr/Instr.hpp"
+#include "../midend/llvm/type/IrBaseType.hpp"
+#include "../midend/llvm/instr/JumpInstr.hpp"
+#include "../midend/llvm/instr/PhiInstr.hpp"
+
+#include <iterator>
+#include <map>
+#include <set>
+
+namespace backend
+{
+
+    namespace
+    {
+
+        bool hasPhi(IrBasicBlock *bb)
+        {
+            return !bb->instructions.empty() && bb->instructions.front()->instrType == InstrType::PHI;
+        }
+
+    } // namespace
+
+    int splitCriticalEdges(IrFunction *func)
+    {
+        int split = 0;
+        for (auto it = func->blocks.begin(); it != func->blocks.end(); ++it)
+        {
+            IrBasicBlock *from = *it;
+            Instr *term = blockTerminator(from);
+            if (!term || term->instrType != InstrType::BR || term->getOperand(1) == term->getOperand(2))
+                continue;
+
+            for (int op = 1; op <= 2; ++op)
+            {
+                auto *to = dynamic_cast<IrBasicBlock *>(term->getOperand(op));
+                if (!to || !hasPhi(to))
+                    continue;
+
+                // Inserted right after the source block, so the split block is
+                // still a fallthrough candidate for the branch.
+                auto *edge = new IrBasicBlock(from->name + "_to_" + to->name, func);
+                auto *jump = new JumpInstr(to);
+                edge->addInstr(jump);
+                jump->parentBlock = edge;
+                it = func->blocks.insert(std::next(it), edge);
+
+                term->setOperand(op, edge);
+                for (auto *instr : to->instructions)
+                {
+                    auto *phi = dynamic_cast<PhiInstr *>(instr);
+                    if (!phi)
+                        break;
+                    phi->replaceIncomingBlock(from, edge);
+                }
+                ++split;
+            }
+        }
+        return split;
+    }
+
+    // Boissinot et al., "Revisiting Out-of-SSA Translation for Correctness,
+    // Code Quality, and Efficiency": a destination is written once nothing
+    // still needs its old value; `loc` tracks where each source value
+    // currently lives so fan-out copies keep reading the right place.
+    std::vector<CopyMove> sequentializeCopies(const std::vector<CopyMove> &copies, CopyLocation temp)
+    {
+        std::vector<CopyMove> result;
+        std::vector<CopyMove> materialized;
+        std::map<CopyLocation, CopyLocation> loc;  // value origin -> current location
+        std::map<CopyLocation, CopyLocation> pred; // dst -> src
+        std::map<CopyLocation, IrValue *> valueOf;
+        std::set<CopyLocation> done;
+        std::vector<CopyLocation> ready;
+        std::vector<CopyLocation> todo;
+
+        for (const auto &c : copies)
+        {
+            if (c.src.isNone())
+                materialized.push_back(c);
+            else if (c.src != c.dst)
+            {
+                loc[c.src] = c.src;
+                pred[c.dst] = c.src;
+                valueOf[c.dst] = c.value;
+                todo.push_back(c.dst);
+            }
+        }
+        for (const auto &dst : todo)
+        {
+            if (!loc.count(dst))
+                ready.push_back(dst);
+        }
+
+        while (!todo.empty())
+        {
+            while (!ready.empty())
+            {
+                CopyLocation b = ready.back();
+                ready.pop_back();
+                const CopyLocation a = pred[b];
+                const CopyLocation c = loc[a];
+                result.push_back({b, c, valueOf[b]});
+                done.insert(b);
+                loc[a] = b;
+                if (a == c && pred.count(a))
+                    ready.push_back(a);
+            }
+
+            CopyLocation b = todo.back();
+            todo.pop_back();
+            // Nothing is ready, so an unwritten b sits on a cycle. Park its
+            // old value in `temp`, which frees b.
+            if (!done.count(b))
+            {
+                result.push_back({temp, b, nullptr});
+                loc[b] = temp;
+                ready.push_back(b);
+            }
+        }
+
+        // Materialized values read no location, so they go last.
+        result.insert(result.end(), materialized.begin(), materialized.end());
+        return result;
+    }
+
+} // namespace backend
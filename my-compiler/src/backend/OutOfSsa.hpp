@@ -0,0 +1,67 @@
+#pragma once
+
+#include "MachineIR.hpp"
+
+#include <vector>
+
+class IrFunction;
+class IrValue;
+
+namespace backend
+{
+
+    // Out-of-SSA support for the MIPS backend. Phis stay in the IR until code
+    // generation; each CFG edge into a phi block then carries a parallel copy
+    // that is emitted at the end of the predecessor, right before its jump.
+
+    // Makes every such edge leave a block with a single successor: an edge
+    // from a conditional branch into a block with phis gets a new block that
+    // only jumps to the target. Edges into phi-free blocks are left alone.
+    // Returns the number of edges split.
+    int splitCriticalEdges(IrFunction *func);
+
+    // Where a value lives while copies run: a register or an $fp-relative
+    // stack slot. `None` marks a value with no location of its own
+    // (constant, global, alloca).
+    struct CopyLocation
+    {
+        enum class Kind : uint8_t
+        {
+            None,
+            Reg,
+            Stack,
+        };
+
+        Kind kind = Kind::None;
+        PReg reg = PReg::ZERO;
+        int offset = 0;
+
+        static CopyLocation inRegister(PReg r) { return {Kind::Reg, r, 0}; }
+        static CopyLocation onStack(int offset) { return {Kind::Stack, PReg::ZERO, offset}; }
+
+        bool isNone() const { return kind == Kind::None; }
+        bool operator==(const CopyLocation &o) const { return kind == o.kind && reg == o.reg && offset == o.offset; }
+        bool operator!=(const CopyLocation &o) const { return !(*this == o); }
+        bool operator<(const CopyLocation &o) const
+        {
+            if (kind != o.kind)
+                return kind < o.kind;
+            return reg != o.reg ? reg < o.reg : offset < o.offset;
+        }
+    };
+
+    // One copy of a parallel copy. A `src` of kind None means `value` is
+    // materialized into `dst`.
+    struct CopyMove
+    {
+        CopyLocation dst;
+        CopyLocation src;
+        IrValue *value = nullptr;
+    };
+
+    // Orders a parallel copy (every source read before any destination is
+    // written) into sequential moves. Cycles are broken through `temp`, which
+    // must not occur as a location in `copies`. Self-copies are dropped.
+    std::vector<CopyMove> sequentializeCopies(const std::vector<CopyMove> &copies, CopyLocation temp);
+
+} // namespace backend
@@ -0,0 +1,227 @@
+#include "Peephole.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace backend
+{
+
+    namespace
+    {
+
+        using Iter = PeepholeOptimizer::Iter;
+
+        // How far deadAfter looks before giving up.
+        constexpr std::size_t kDeadScanLimit = 32;
+
+        bool isScratch(const MOperand &reg)
+        {
+            return reg.isPReg(PReg::T8) || reg.isPReg(PReg::T9) || reg.isPReg(PReg::V1);
+        }
+
+        bool fitsImm16(int64_t v)
+        {
+            return v >= -32768 && v <= 32767;
+        }
+
+        bool contains(const std::vector<MOperand> &regs, const MOperand &reg)
+        {
+            return std::find(regs.begin(), regs.end(), reg) != regs.end();
+        }
+
+        bool is(const MachineBasicBlock &bb, Iter it, MOpcode op)
+        {
+            return it != bb.instrs.end() && it->opcode == op;
+        }
+
+        // True if `reg` is overwritten before being read after `it`. Only
+        // scratch registers are known to be dead when control leaves the
+        // block.
+        bool deadAfter(const MachineBasicBlock &bb, Iter it, const MOperand &reg)
+        {
+            std::size_t scanned = 0;
+            for (auto j = std::next(it); j != bb.instrs.end(); ++j)
+            {
+                if (++scanned > kDeadScanLimit)
+                    return false;
+                std::vector<MOperand> uses, defs;
+                if (!j->regEffects(uses, defs))
+                    return false;
+                if (contains(uses, reg))
+                    return false;
+                if (contains(defs, reg))
+                    return true;
+                if (j->info().isBranch || j->info().isJump)
+                    return isScratch(reg);
+            }
+            return isScratch(reg);
+        }
+
+        // move $x, $x
+        bool selfMove(MachineFunction &mf, std::size_t b, Iter &it)
+        {
+            if (it->opcode != MOpcode::MOVE || it->operands[0] != it->operands[1])
+                return false;
+            it = mf.blocks[b]->instrs.erase(it);
+            return true;
+        }
+
+        // sw $r, M ; lw $d, M  ->  sw $r, M ; move $d, $r
+        bool storeLoad(MachineFunction &mf, std::size_t b, Iter &it)
+        {
+            auto &bb = *mf.blocks[b];
+            auto next = std::next(it);
+            if (it->opcode != MOpcode::SW || !is(bb, next, MOpcode::LW))
+                return false;
+            if (it->operands[1] != next->operands[1])
+                return false;
+            if (next->operands[0] == it->operands[0])
+                bb.instrs.erase(next);
+            else
+                *next = MachineInstr(MOpcode::MOVE, {next->operands[0], it->operands[0]});
+            return true;
+        }
+
+        // lw $r, M ; sw $r, M  ->  lw $r, M   (unless $r is M's base)
+        bool loadStore(MachineFunction &mf, std::size_t b, Iter &it)
+        {
+            auto &bb = *mf.blocks[b];
+            auto next = std::next(it);
+            if (it->opcode != MOpcode::LW || !is(bb, next, MOpcode::SW))
+                return false;
+            const MOperand &r = it->operands[0];
+            const MOperand &m = it->operands[1];
+            if (next->operands[0] != r || next->operands[1] != m || r.isPReg(m.preg()))
+                return false;
+            bb.instrs.erase(next);
+            return true;
+        }
+
+        // j L / branch to L, where L is the next block in layout order (both
+        // paths of a branch reach it).
+        bool jumpToNext(MachineFunction &mf, std::size_t b, Iter &it)
+        {
+            auto &bb = *mf.blocks[b];
+            if (!it->info().isBranch && it->opcode != MOpcode::J)
+                return false;
+            if (std::next(it) != bb.instrs.end())
+                return false;
+            const MOperand &target = it->operands.back();
+            for (std::size_t n = b + 1; n < mf.blocks.size(); ++n)
+            {
+                if (target.kind == MOperand::Kind::Block && target.block == mf.blocks[n].get())
+                {
+                    it = bb.instrs.erase(it);
+                    return true;
+                }
+                if (!mf.blocks[n]->instrs.empty())
+                    break;
+            }
+            return false;
+        }
+
+        // li $r, k ; move $d, $r  ->  li $d, k   (when $r is dead)
+        // la $r, s ; move $d, $r  ->  la $d, s
+        bool liMove(MachineFunction &mf, std::size_t b, Iter &it)
+        {
+            auto &bb = *mf.blocks[b];
+            auto next = std::next(it);
+            if ((it->opcode != MOpcode::LI && it->opcode != MOpcode::LA) || !is(bb, next, MOpcode::MOVE))
+                return false;
+            const MOperand r = it->operands[0];
+            if (next->operands[1] != r || !deadAfter(bb, next, r))
+                return false;
+            it->operands[0] = next->operands[0];
+            bb.instrs.erase(next);
+            return true;
+        }
+
+        // li $r, k ; addu $d, $a, $r  ->  addiu $d, $a, k
+        // li $r, k ; subu $d, $a, $r  ->  addiu $d, $a, -k
+        bool liAddu(MachineFunction &mf, std::size_t b, Iter &it)
+        {
+            auto &bb = *mf.blocks[b];
+            auto next = std::next(it);
+            if (it->opcode != MOpcode::LI || next == bb.instrs.end())
+                return false;
+            const MOpcode op = next->opcode;
+            if (op != MOpcode::ADDU && op != MOpcode::SUBU)
+                return false;
+            if (it->operands[1].kind != MOperand::Kind::Imm)
+                return false;
+            int64_t k = it->operands[1].imm;
+            const MOperand r = it->operands[0];
+            const auto &args = next->operands;
+            MOperand other;
+            if (args[2] == r && args[1] != r)
+                other = args[1];
+            else if (op == MOpcode::ADDU && args[1] == r && args[2] != r)
+                other = args[2];
+            else
+                return false;
+            if (op == MOpcode::SUBU)
+                k = -k;
+            if (!fitsImm16(k))
+                return false;
+            if (args[0] != r && !deadAfter(bb, next, r))
+                return false;
+            *it = MachineInstr(MOpcode::ADDIU, {args[0], other, MOperand::immediate(k)});
+            bb.instrs.erase(next);
+            return true;
+        }
+
+    } // namespace
+
+    PeepholeOptimizer::PeepholeOptimizer()
+        : rules{
+              {"self-move", selfMove},
+              {"store-load", storeLoad},
+              {"load-store", loadStore},
+              {"jump-to-next", jumpToNext},
+              {"li-move", liMove},
+              {"li-addu", liAddu},
+          },
+          hits(rules.size(), 0)
+    {
+    }
+
+    void PeepholeOptimizer::run(MachineFunction &mf)
+    {
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+            for (std::size_t b = 0; b < mf.blocks.size(); ++b)
+            {
+                auto &instrs = mf.blocks[b]->instrs;
+                auto it = instrs.begin();
+                while (it != instrs.end())
+                {
+                    bool applied = false;
+                    for (std::size_t r = 0; r < rules.size(); ++r)
+                    {
+                        if (rules[r].apply(mf, b, it))
+                        {
+                            ++hits[r];
+                            applied = true;
+                            changed = true;
+                            break;
+                        }
+                    }
+                    // Retry the rules on the rewritten instruction.
+                    if (!applied)
+                        ++it;
+                }
+            }
+        }
+    }
+
+    std::vector<std::pair<std::string, long>> PeepholeOptimizer::hitCounts() const
+    {
+        std::vector<std::pair<std::string, long>> result;
+        for (std::size_t r = 0; r < rules.size(); ++r)
+            result.push_back({rules[r].name, hits[r]});
+        return result;
+    }
+
+} // namespace backend
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "MachineIR.hpp"
+
+#include <list>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace backend
+{
+
+    // Windowed peephole optimizer over machine IR. Each rule looks at a small
+    // window starting at one instruction and rewrites it in place; the rule
+    // table is applied until nothing changes. Only $t8/$t9/$v1 (the backend's
+    // scratch registers) are assumed dead at block boundaries, and
+    // dead-register checks look at most a fixed number of instructions ahead,
+    // so rules never need global liveness and a sweep stays linear.
+    class PeepholeOptimizer
+    {
+    public:
+        using Iter = std::list<MachineInstr>::iterator;
+        // Returns false if the rule does not match at `it`. A rule that
+        // erases `it` leaves it pointing at the following instruction.
+        using RuleFn = bool (*)(MachineFunction &mf, std::size_t block, Iter &it);
+        struct Rule
+        {
+            const char *name;
+            RuleFn apply;
+        };
+
+        PeepholeOptimizer();
+
+        void run(MachineFunction &mf);
+
+        // (rule name, number of rewrites) for every rule, in table order.
+        std::vector<std::pair<std::string, long>> hitCounts() const;
+
+    private:
+        std::vector<Rule> rules;
+        std::vector<long> hits;
+    };
+
+} // namespace backend
@@ -0,0 +1,47 @@
+#include "RegisterAllocator.hpp"
+#include "AdaptiveAllocator.hpp"
+#include "GraphColoringAllocator.hpp"
+#include "LinearScanAllocator.hpp"
+#include "Liveness.hpp"
+
+#include "../midend/llvm/value/IrFunction.hpp"
+#include "../midend/llvm/value/IrBasicBlock.hpp"
+#include "../midend/llvm/instr/Instr.hpp"
+
+namespace backend
+{
+
+    std::size_t countAllocatableValues(IrFunction *func)
+    {
+        std::size_t count = func->params.size();
+        for (auto *bb : func->blocks)
+        {
+            Instr *term = blockTerminator(bb);
+            for (auto *instr : bb->instructions)
+            {
+                if (isAllocatable(instr))
+                    ++count;
+                if (instr == term)
+                    break;
+            }
+        }
+        return count;
+    }
+
+    std::unique_ptr<RegisterAllocator> createRegisterAllocator(RegAllocMode mode)
+    {
+        switch (mode)
+        {
+        case RegAllocMode::GraphColoring:
+            return std::make_unique<GraphColoringAllocator>();
+        case RegAllocMode::LinearScan:
+            return std::make_unique<LinearScanAllocator>();
+        case RegAllocMode::Auto:
+            return std::make_unique<AdaptiveAllocator>();
+        case RegAllocMode::Stack:
+        default:
+            return nullptr;
+        }
+    }
+
+} // namespace backend
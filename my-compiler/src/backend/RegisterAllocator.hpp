@@ -0,0 +1,78 @@
+#pragma once
+
+#include "MachineIR.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class IrFunction;
+class IrValue;
+
+namespace backend
+{
+
+    // Registers handed out to SSA values. $t8/$t9/$v1 are never allocated:
+    // MipsGenerator keeps them as scratch registers for spilled operands,
+    // materialized constants and breaking phi-copy cycles.
+    inline const std::vector<PReg> &callerSavedRegisters()
+    {
+        static const std::vector<PReg> regs = {
+            PReg::T0, PReg::T1, PReg::T2, PReg::T3, PReg::T4, PReg::T5, PReg::T6, PReg::T7};
+        return regs;
+    }
+
+    inline const std::vector<PReg> &calleeSavedRegisters()
+    {
+        static const std::vector<PReg> regs = {
+            PReg::S0, PReg::S1, PReg::S2, PReg::S3, PReg::S4, PReg::S5, PReg::S6, PReg::S7};
+        return regs;
+    }
+
+    inline bool isCalleeSaved(PReg r)
+    {
+        return r >= PReg::S0 && r <= PReg::S7;
+    }
+
+    // Result of allocating one function. Values missing from `registers` are
+    // spilled: they keep a $fp-relative stack slot and are reloaded into a
+    // scratch register at every use.
+    struct RegisterAssignment
+    {
+        std::unordered_map<IrValue *, PReg> registers;
+        std::vector<PReg> usedCalleeSaved; // saved/restored by the function
+        std::string method;                       // allocator that produced it
+    };
+
+    class RegisterAllocator
+    {
+    public:
+        virtual ~RegisterAllocator() = default;
+        virtual std::string name() const = 0;
+        virtual RegisterAssignment allocate(IrFunction *func) = 0;
+    };
+
+    // Allocation strategy selected by the driver.
+    //   Stack         - no allocator, every value lives in a stack slot
+    //   GraphColoring - GraphColoringAllocator for every function
+    //   LinearScan    - LinearScanAllocator for every function
+    //   Auto          - graph coloring, falling back to linear scan for
+    //                   functions with more than `coloringLimit` values
+    enum class RegAllocMode
+    {
+        Stack,
+        GraphColoring,
+        LinearScan,
+        Auto,
+    };
+
+    // Number of values (parameters and non-void, non-alloca instructions) the
+    // allocator has to place for `func`.
+    std::size_t countAllocatableValues(IrFunction *func);
+
+    // Returns nullptr for RegAllocMode::Stack.
+    std::unique_ptr<RegisterAllocator> createRegisterAllocator(RegAllocMode mode);
+
+} // namespace backend
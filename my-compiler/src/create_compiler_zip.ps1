@@ -24,6 +24,7 @@ $items = @(
     'frontend',
     'midend',
     'optimize',
+    'utils',
     'CMakeLists.txt',
     'config.json',
     'main.cpp',
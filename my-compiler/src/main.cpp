@@ -8,12 +8,28 @@
 #include "midend/symbol/SymbolManager.hpp"
 #include "midend/irgen/IRGenerator.hpp"
 #include "backend/MipsGenerator.hpp"
+#include "backend/RegisterAllocator.hpp"
 #include "optimize/PassManager.hpp"
+#include "optimize/SimplifyCfg.hpp"
+#include "optimize/LocalizeGlobals.hpp"
+#include "optimize/Sroa.hpp"
 #include "optimize/Mem2Reg.hpp"
+#include "optimize/TailRecursion.hpp"
+#include "optimize/Inliner.hpp"
+#include "optimize/Sccp.hpp"
+#include "optimize/Gvn.hpp"
+#include "optimize/LoadElim.hpp"
+#include "optimize/DeadStoreElim.hpp"
+#include "optimize/Licm.hpp"
+#include "optimize/LoopUnroll.hpp"
+#include "optimize/StrengthReduce.hpp"
+#include "optimize/Dce.hpp"
+#include "utils/CompileStats.hpp"
 #include <fstream>
 #include <iostream>
 #include <algorithm>
 #include <cstdio>
+#include <sstream>
 #include <string>
 
 int main(int argc, char **argv)
@@ -40,6 +56,23 @@ int main(int argc, char **argv)
     // Only relevant when stopAfter == Mips.
     const bool enableOpt = true;     // master switch
     const bool enableMem2Reg = true; // per-pass switch
+    const bool enableSimplifyCfg = true;
+    const bool enableLocalizeGlobals = true;
+    const bool enableSroa = true;
+    const bool enableTailRecursion = true;
+    const bool enableInline = true;
+    const bool enableSccp = true;
+    const bool enableGvn = true;
+    const bool enableLoadElim = true;
+    const bool enableDse = true;
+    const bool enableLicm = true;
+    const bool enableUnroll = true;
+    const bool enableStrengthReduce = true;
+    const bool enableDce = true;
+    // Backend register allocation: Stack (no allocation), GraphColoring,
+    // LinearScan, or Auto (graph coloring, linear scan for huge functions).
+    const backend::RegAllocMode regAllocMode = backend::RegAllocMode::Auto;
+    const bool dumpCompileStats = true; // compile_stats.txt
 
     (void)argc;
     (void)argv;
@@ -76,6 +109,7 @@ int main(int argc, char **argv)
     std::remove("mips.txt");
     std::remove("mips_before.txt");
     std::remove("mips_after.txt");
+    std::remove("compile_stats.txt");
 
     Lexer lexer(input);
     // Let the lexer produce the full token list itself.
@@ -242,17 +276,94 @@ int main(int argc, char **argv)
             {
                 std::ofstream mipsBefore("mips_before.txt");
                 MipsGenerator mipsGenBefore(generator.module, mipsBefore);
+                mipsGenBefore.setRecordStats(false);
                 mipsGenBefore.generate();
             }
 
             // Run optimization pipeline (extendable)
             optimize::PassManager pm;
+            if (enableSimplifyCfg)
+            {
+                pm.addPass(std::make_unique<optimize::SimplifyCfgPass>());
+            }
+            if (enableLocalizeGlobals)
+            {
+                pm.addPass(std::make_unique<optimize::LocalizeGlobalsPass>());
+            }
+            if (enableSroa)
+            {
+                pm.addPass(std::make_unique<optimize::SroaPass>());
+            }
             if (enableMem2Reg)
             {
                 pm.addPass(std::make_unique<optimize::Mem2RegPass>());
             }
+            if (enableTailRecursion)
+            {
+                pm.addPass(std::make_unique<optimize::TailRecursionPass>());
+            }
+            if (enableInline)
+            {
+                pm.addPass(std::make_unique<optimize::InlinePass>());
+            }
+            if (enableSccp)
+            {
+                pm.addPass(std::make_unique<optimize::SccpPass>());
+            }
+            if (enableGvn)
+            {
+                pm.addPass(std::make_unique<optimize::GvnPass>());
+            }
+            if (enableLoadElim)
+            {
+                pm.addPass(std::make_unique<optimize::LoadElimPass>());
+            }
+            if (enableLicm)
+            {
+                pm.addPass(std::make_unique<optimize::LicmPass>());
+            }
+            if (enableUnroll)
+            {
+                // The copies carry constants forward from one iteration to
+                // the next; fold them and merge what became redundant.
+                pm.addPass(std::make_unique<optimize::LoopUnrollPass>());
+                pm.addPass(std::make_unique<optimize::SccpPass>());
+                pm.addPass(std::make_unique<optimize::GvnPass>());
+            }
+            if (enableLoadElim)
+            {
+                // Unrolled iterations reload what the previous one stored.
+                pm.addPass(std::make_unique<optimize::LoadElimPass>());
+            }
+            if (enableSroa && enableMem2Reg)
+            {
+                // Full unrolling turns loop indices into constants.
+                pm.addPass(std::make_unique<optimize::SroaPass>());
+                pm.addPass(std::make_unique<optimize::Mem2RegPass>("%sroa.phi"));
+                pm.addPass(std::make_unique<optimize::SccpPass>());
+            }
+            if (enableStrengthReduce)
+            {
+                pm.addPass(std::make_unique<optimize::StrengthReducePass>());
+            }
+            if (enableSimplifyCfg)
+            {
+                // Inlining, unrolling and branch folding leave jump chains.
+                pm.addPass(std::make_unique<optimize::SimplifyCfgPass>());
+            }
+            if (enableDse)
+            {
+                // Block-local, so after the merged blocks are whole again.
+                pm.addPass(std::make_unique<optimize::DeadStoreElimPass>());
+            }
+            if (enableDce)
+            {
+                pm.addPass(std::make_unique<optimize::DcePass>());
+            }
             pm.run(generator.module);
 
+            auto allocator = backend::createRegisterAllocator(regAllocMode);
+
             // Dump optimized LLVM
             {
                 std::ofstream llvmAfter("llvm_ir_after.txt");
@@ -263,16 +374,19 @@ int main(int argc, char **argv)
                 generator.module->print(llvmFile);
             }
 
-            // Dump optimized MIPS
+            // Dump optimized MIPS (generated once, register allocation is not free)
+            std::stringstream mipsText;
+            {
+                MipsGenerator mipsGen(generator.module, mipsText, allocator.get());
+                mipsGen.generate();
+            }
             {
                 std::ofstream mipsAfter("mips_after.txt");
-                MipsGenerator mipsGenAfter(generator.module, mipsAfter);
-                mipsGenAfter.generate();
+                mipsAfter << mipsText.str();
             }
             {
                 std::ofstream mipsFile("mips.txt");
-                MipsGenerator mipsGen(generator.module, mipsFile);
-                mipsGen.generate();
+                mipsFile << mipsText.str();
             }
         }
         else
@@ -287,6 +401,9 @@ int main(int argc, char **argv)
         }
     }
 
+    if (dumpCompileStats)
+        CompileStats::Dump("compile_stats.txt");
+
     std::remove("error.txt");
 
     return 0;
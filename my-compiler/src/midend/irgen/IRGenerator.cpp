@@ -1005,83 +1005,60 @@ void IRGenerator::visitStmt(ASTNode *node)
             }
         }
 
+        // Literal text between conversions is collected into `text` and
+        // printed as one string; only %d and %c need a call of their own.
+        Symbol *putintSym = findSymbol("putint");
+        Symbol *putchSym = findSymbol("putch");
+        std::string text;
         int argIdx = 0;
         for (size_t i = 0; i < format.size(); ++i)
         {
-            if (format[i] == '%' && i + 1 < format.size())
+            if (format[i] == '%' && i + 1 < format.size() && (format[i + 1] == 'd' || format[i + 1] == 'c'))
             {
-                if (format[i + 1] == 'd')
+                Symbol *sym = format[i + 1] == 'd' ? putintSym : putchSym;
+                if (argIdx < (int)args.size() && sym && sym->llvmValue)
                 {
-                    if (argIdx < (int)args.size())
-                    {
-                        Symbol *putintSym = findSymbol("putint");
-                        if (putintSym && putintSym->llvmValue)
-                        {
-                            IrBuilder::insertInstr(new CallInstr((IrFunction *)putintSym->llvmValue, {args[argIdx++]}, getNewName("call")));
-                        }
-                    }
-                    i++;
-                }
-                else if (format[i + 1] == 'c')
-                {
-                    if (argIdx < (int)args.size())
-                    {
-                        Symbol *putchSym = findSymbol("putch");
-                        if (putchSym && putchSym->llvmValue)
-                        {
-                            IrBuilder::insertInstr(new CallInstr((IrFunction *)putchSym->llvmValue, {args[argIdx++]}, getNewName("call")));
-                        }
-                    }
-                    i++;
-                }
-                else if (format[i + 1] == '%')
-                {
-                    Symbol *putchSym = findSymbol("putch");
-                    if (putchSym && putchSym->llvmValue)
-                    {
-                        IrBuilder::insertInstr(new CallInstr((IrFunction *)putchSym->llvmValue, {IrConstantInt::get('%')}, getNewName("call")));
-                    }
-                    i++;
-                }
-                else
-                {
-                    Symbol *putchSym = findSymbol("putch");
-                    if (putchSym && putchSym->llvmValue)
-                    {
-                        IrBuilder::insertInstr(new CallInstr((IrFunction *)putchSym->llvmValue, {IrConstantInt::get('%')}, getNewName("call")));
-                    }
+                    emitPrintText(text);
+                    text.clear();
+                    IrBuilder::insertInstr(new CallInstr((IrFunction *)sym->llvmValue, {args[argIdx++]}, getNewName("call")));
                 }
+                i++;
+            }
+            else if (format[i] == '%' && i + 1 < format.size() && format[i + 1] == '%')
+            {
+                text += '%';
+                i++;
             }
             else if (format[i] == '\\' && i + 1 < format.size())
             {
-                int charCode = format[i + 1];
+                char ch = format[i + 1];
                 if (format[i + 1] == 'n')
-                    charCode = 10;
+                    ch = 10;
                 else if (format[i + 1] == 't')
-                    charCode = 9;
-                else if (format[i + 1] == '\"')
-                    charCode = 34;
-                else if (format[i + 1] == '\\')
-                    charCode = 92;
+                    ch = 9;
                 else if (format[i + 1] == '0')
-                    charCode = 0;
+                    ch = 0;
+                i++;
 
-                Symbol *putchSym = findSymbol("putch");
-                if (putchSym && putchSym->llvmValue)
+                if (ch == 0)
                 {
-                    IrBuilder::insertInstr(new CallInstr((IrFunction *)putchSym->llvmValue, {IrConstantInt::get(charCode)}, getNewName("call")));
+                    // A NUL would end an .asciiz string early.
+                    emitPrintText(text);
+                    text.clear();
+                    if (putchSym && putchSym->llvmValue)
+                        IrBuilder::insertInstr(new CallInstr((IrFunction *)putchSym->llvmValue, {IrConstantInt::get(0)}, getNewName("call")));
+                }
+                else
+                {
+                    text += ch;
                 }
-                i++;
             }
             else
             {
-                Symbol *putchSym = findSymbol("putch");
-                if (putchSym && putchSym->llvmValue)
-                {
-                    IrBuilder::insertInstr(new CallInstr((IrFunction *)putchSym->llvmValue, {IrConstantInt::get(format[i])}, getNewName("call")));
-                }
+                text += format[i];
             }
         }
+        emitPrintText(text);
     }
     else if (node->children[0]->name == "Exp")
     {
@@ -1579,3 +1556,40 @@ void IRGenerator::visitForStmt(ASTNode *node)
         }
     }
 }
+
+IrValue *IRGenerator::getStringLiteral(const std::string &text)
+{
+    IrGlobalValue *&gv = stringLiterals[text];
+    if (!gv)
+    {
+        IrType *i8 = IrBaseType::getInt8();
+        std::vector<IrConstant *> chars;
+        for (char ch : text)
+            chars.push_back(new IrConstantInt(i8, (unsigned char)ch));
+        chars.push_back(new IrConstantInt(i8, 0));
+        IrArrayType *type = new IrArrayType(i8, (int)chars.size());
+        gv = new IrGlobalValue(type, "@.str." + std::to_string(stringLiterals.size() - 1), new IrConstantArray(type, chars), true);
+        module->addGlobalValue(gv);
+    }
+    auto *gep = new GepInstr(gv, {IrConstantInt::get(0), IrConstantInt::get(0)}, getNewName("str"));
+    IrBuilder::insertInstr(gep);
+    return gep;
+}
+
+// A single character is cheaper as putch than as a string address plus
+// print-string syscall, so only longer runs become string literals.
+void IRGenerator::emitPrintText(const std::string &text)
+{
+    if (text.empty())
+        return;
+    if (text.size() == 1)
+    {
+        Symbol *putchSym = findSymbol("putch");
+        if (putchSym && putchSym->llvmValue)
+            IrBuilder::insertInstr(new CallInstr((IrFunction *)putchSym->llvmValue, {IrConstantInt::get((unsigned char)text[0])}, getNewName("call")));
+        return;
+    }
+    Symbol *putstrSym = findSymbol("putstr");
+    if (putstrSym && putstrSym->llvmValue)
+        IrBuilder::insertInstr(new CallInstr((IrFunction *)putstrSym->llvmValue, {getStringLiteral(text)}, getNewName("call")));
+}
@@ -3,6 +3,7 @@
 #include "../llvm/IrModule.hpp"
 #include "../llvm/IrBuilder.hpp"
 #include "../symbol/SymbolTable.hpp"
+#include <map>
 #include <memory>
 #include <stack>
 
@@ -48,6 +49,12 @@ private:
 
     void initLibraryFunctions();
 
+    // Constant `.str.N` globals for printf text, keyed by contents so that
+    // repeated segments share one copy in the data section.
+    std::map<std::string, IrGlobalValue*> stringLiterals;
+    IrValue* getStringLiteral(const std::string& text);
+    void emitPrintText(const std::string& text);
+
     // Helper to find symbol in current or parent scopes
     Symbol* findSymbol(const std::string& name);
 
@@ -2,41 +2,40 @@
 #include "Instr.hpp"
 #include "../value/IrBasicBlock.hpp"
 
-#include <vector>
-
 class PhiInstr : public Instr
 {
 public:
-    struct Incoming
-    {
-        IrBasicBlock *block;
-        IrValue *value;
-    };
-
     explicit PhiInstr(IrType *t, std::string n)
         : Instr(t, InstrType::PHI, n)
     {
     }
 
+    // operandList stores [value0, block0, value1, block1, ...]
     void addIncoming(IrValue *v, IrBasicBlock *from)
     {
-        incoming.push_back({from, v});
         addOperand(v);
         addOperand(from);
     }
 
     IrValue *getIncomingValue(IrBasicBlock *from) const
     {
-        for (const auto &inc : incoming)
+        for (size_t i = 0; i + 1 < operandList.size(); i += 2)
         {
-            if (inc.block == from)
-                return inc.value;
+            if (getOperand((int)i + 1) == from)
+                return getOperand((int)i);
         }
         return nullptr;
     }
 
-    std::string toString() const override;
+    // Retarget the incoming edge from `from` to come from `to` instead.
+    void replaceIncomingBlock(IrBasicBlock *from, IrBasicBlock *to)
+    {
+        for (size_t i = 0; i + 1 < operandList.size(); i += 2)
+        {
+            if (getOperand((int)i + 1) == from)
+                setOperand((int)i + 1, to);
+        }
+    }
 
-private:
-    std::vector<Incoming> incoming;
+    std::string toString() const override;
 };
@@ -11,4 +11,5 @@ public:
 
     void addOperand(IrValue* v);
     IrValue* getOperand(int i) const { return operandList[i]->value; }
+    void setOperand(int i, IrValue* v); // keeps both use lists consistent
 };
@@ -24,3 +24,10 @@ void IrUser::addOperand(IrValue* v) {
     operandList.push_back(use);
     if (v) v->addUse(use);
 }
+
+void IrUser::setOperand(int i, IrValue* v) {
+    IrUse* use = operandList[i];
+    if (use->value) use->value->useList.remove(use);
+    use->value = v;
+    if (v) v->addUse(use);
+}
@@ -0,0 +1,159 @@
+#include "AliasAnalysis.hpp"
+
+#include "../midend/llvm/IrModule.hpp"
+#include "../midend/llvm/value/IrFunction.hpp"
+#include "../midend/llvm/value/IrBasicBlock.hpp"
+#include "../midend/llvm/value/IrConstantInt.hpp"
+#include "../midend/llvm/value/IrGlobalValue.hpp"
+#include "../midend/llvm/type/IrArrayType.hpp"
+#include "../midend/llvm/type/IrPointerType.hpp"
+#include "../midend/llvm/instr/Instr.hpp"
+#include "../midend/llvm/instr/AllocaInstr.hpp"
+
+namespace optimize
+{
+
+    IrValue *pointerBase(IrValue *ptr)
+    {
+        while (auto *instr = dynamic_cast<Instr *>(ptr))
+        {
+            if (instr->instrType != InstrType::GEP)
+                break;
+            ptr = instr->getOperand(0);
+        }
+        return ptr;
+    }
+
+    bool isIdentifiedObject(IrValue *base)
+    {
+        return dynamic_cast<AllocaInstr *>(base) || dynamic_cast<IrGlobalValue *>(base);
+    }
+
+    long long sizeOf(IrType *type)
+    {
+        if (type->isInt8())
+            return 1;
+        if (auto *arr = dynamic_cast<IrArrayType *>(type))
+            return arr->numElements * sizeOf(arr->elementType);
+        return 4;
+    }
+
+    bool constantOffset(IrValue *ptr, long long &offset)
+    {
+        offset = 0;
+        while (auto *gep = dynamic_cast<Instr *>(ptr))
+        {
+            if (gep->instrType != InstrType::GEP)
+                break;
+            IrValue *base = gep->getOperand(0);
+            IrType *type = static_cast<IrPointerType *>(base->type)->pointedType;
+            for (size_t i = 1; i < gep->operandList.size(); ++i)
+            {
+                auto *c = dynamic_cast<IrConstantInt *>(gep->getOperand((int)i));
+                if (!c)
+                    return false;
+                if (i > 1)
+                    type = static_cast<IrArrayType *>(type)->elementType;
+                offset += c->value * sizeOf(type);
+            }
+            ptr = base;
+        }
+        return true;
+    }
+
+    bool addressTaken(IrValue *ptr)
+    {
+        for (auto *use : ptr->useList)
+        {
+            auto *user = dynamic_cast<Instr *>(use->user);
+            if (!user)
+                return true;
+            switch (user->instrType)
+            {
+            case InstrType::LOAD:
+                break;
+            case InstrType::STORE:
+                if (user->getOperand(0) == ptr)
+                    return true;
+                break;
+            case InstrType::GEP:
+                if (user->getOperand(0) != ptr || addressTaken(user))
+                    return true;
+                break;
+            default:
+                return true;
+            }
+        }
+        return false;
+    }
+
+    AliasAnalysis::AliasAnalysis(IrModule *module) : sideEffects(module)
+    {
+        for (auto *func : module->functions)
+        {
+            if (func->isBuiltin)
+                continue;
+            params.insert(func->params.begin(), func->params.end());
+            for (auto *bb : func->blocks)
+            {
+                for (auto *instr : bb->instructions)
+                {
+                    if (instr->instrType == InstrType::ALLOCA && addressTaken(instr))
+                        escaped.insert(instr);
+                }
+            }
+        }
+    }
+
+    bool AliasAnalysis::isPrivate(IrValue *base) const
+    {
+        return dynamic_cast<AllocaInstr *>(base) && !escapes(base);
+    }
+
+    bool AliasAnalysis::mayAlias(IrValue *a, IrValue *b) const
+    {
+        IrValue *baseA = pointerBase(a);
+        IrValue *baseB = pointerBase(b);
+        if (baseA != baseB)
+        {
+            if (isIdentifiedObject(baseA) && isIdentifiedObject(baseB))
+                return false;
+            if (isPrivate(baseA) || isPrivate(baseB))
+                return false;
+            // The caller's arguments were fixed before this frame existed.
+            if ((dynamic_cast<AllocaInstr *>(baseA) && params.count(baseB)) ||
+                (dynamic_cast<AllocaInstr *>(baseB) && params.count(baseA)))
+                return false;
+            return true;
+        }
+        long long offA, offB;
+        if (constantOffset(a, offA) && constantOffset(b, offB))
+            return offA == offB;
+        return true;
+    }
+
+    bool AliasAnalysis::mustAlias(IrValue *a, IrValue *b) const
+    {
+        if (a == b)
+            return true;
+        long long offA, offB;
+        return pointerBase(a) == pointerBase(b) && constantOffset(a, offA) && constantOffset(b, offB) &&
+               offA == offB;
+    }
+
+    bool AliasAnalysis::callMayWrite(Instr *call, IrValue *ptr) const
+    {
+        if (!sideEffects.writesMemory(dynamic_cast<IrFunction *>(call->getOperand(0))))
+            return false;
+        return !isPrivate(pointerBase(ptr));
+    }
+
+    bool AliasAnalysis::callMayRead(Instr *call, IrValue *ptr) const
+    {
+        auto *callee = dynamic_cast<IrFunction *>(call->getOperand(0));
+        if (callee && callee->isBuiltin && callee->name != "@putarray" && callee->name != "@putstr")
+            return false;
+        return !isPrivate(pointerBase(ptr));
+    }
+
+} // namespace optimize
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "SideEffects.hpp"
+
+#include <unordered_set>
+
+class IrModule;
+class IrType;
+class IrValue;
+class Instr;
+
+namespace optimize
+{
+
+    // The alloca, global or parameter a pointer is derived from via GEPs.
+    IrValue *pointerBase(IrValue *ptr);
+
+    // An alloca or a global: a distinct object no other base reaches.
+    bool isIdentifiedObject(IrValue *base);
+
+    // Bytes an object of `type` occupies in memory.
+    long long sizeOf(IrType *type);
+
+    // Byte offset of a GEP chain from its base when every index is a
+    // constant.
+    bool constantOffset(IrValue *ptr, long long &offset);
+
+    // Whether the address `ptr` (or one derived from it by GEPs) is used
+    // for anything but loading and storing through it: passed to a call,
+    // stored as a value, merged by a phi or compared.
+    bool addressTaken(IrValue *ptr);
+
+    // Memory queries for the optimizer, built once per pass run over the
+    // whole module. Pointers are traced back to their base object:
+    // distinct allocas and globals never overlap, constant paths into the
+    // same object overlap only at equal offsets, and an alloca whose
+    // address never leaves load/store/GEP use is invisible to callees and
+    // to every other pointer. Parameters may point at any global or at an
+    // escaped alloca of some caller, never at this frame's own objects.
+    class AliasAnalysis
+    {
+    public:
+        explicit AliasAnalysis(IrModule *module);
+
+        const SideEffectInfo &effects() const { return sideEffects; }
+
+        bool escapes(IrValue *base) const { return escaped.count(base) != 0; }
+
+        // Whether two pointers may refer to the same memory.
+        bool mayAlias(IrValue *a, IrValue *b) const;
+
+        // Whether two pointers certainly refer to the same memory.
+        bool mustAlias(IrValue *a, IrValue *b) const;
+
+        // Whether a call may write / read what `ptr` points to.
+        bool callMayWrite(Instr *call, IrValue *ptr) const;
+        bool callMayRead(Instr *call, IrValue *ptr) const;
+
+        // A local object no call or foreign pointer can reach.
+        bool isPrivate(IrValue *base) const;
+
+    private:
+        SideEffectInfo sideEffects;
+        std::unordered_set<IrValue *> escaped;
+        std::unordered_set<IrValue *> params;
+    };
+
+} // namespace optimize
@@ -0,0 +1,97 @@
+#include "Dce.hpp"
+#include "SideEffects.hpp"
+
+#include "../midend/llvm/IrModule.hpp"
+#include "../midend/llvm/value/IrFunction.hpp"
+#include "../midend/llvm/value/IrBasicBlock.hpp"
+#include "../midend/llvm/instr/Instr.hpp"
+
+#include <unordered_set>
+#include <vector>
+
+namespace optimize
+{
+
+    namespace
+    {
+
+        bool isRoot(Instr *instr, const SideEffectInfo &effects)
+        {
+            switch (instr->instrType)
+            {
+            case InstrType::BR:
+            case InstrType::JUMP:
+            case InstrType::RET:
+            case InstrType::STORE:
+                return true;
+            case InstrType::CALL:
+                return effects.hasSideEffects(dynamic_cast<IrFunction *>(instr->getOperand(0)));
+            default:
+                return false;
+            }
+        }
+
+        void eliminate(IrFunction *func, const SideEffectInfo &effects)
+        {
+            std::unordered_set<Instr *> live;
+            std::vector<Instr *> work;
+            for (auto *bb : func->blocks)
+            {
+                for (auto *instr : bb->instructions)
+                {
+                    if (isRoot(instr, effects))
+                    {
+                        live.insert(instr);
+                        work.push_back(instr);
+                    }
+                }
+            }
+
+            while (!work.empty())
+            {
+                Instr *instr = work.back();
+                work.pop_back();
+                for (auto *use : instr->operandList)
+                {
+                    auto *def = dynamic_cast<Instr *>(use->value);
+                    if (def && live.insert(def).second)
+                        work.push_back(def);
+                }
+            }
+
+            for (auto *bb : func->blocks)
+            {
+                for (auto it = bb->instructions.begin(); it != bb->instructions.end();)
+                {
+                    Instr *instr = *it;
+                    if (live.count(instr))
+                    {
+                        ++it;
+                        continue;
+                    }
+                    // Its users are dead too, so only the operands' use
+                    // lists need fixing up.
+                    for (auto *use : instr->operandList)
+                        use->value->removeUse(instr);
+                    it = bb->instructions.erase(it);
+                }
+            }
+        }
+
+    } // namespace
+
+    void DcePass::run(IrModule *module)
+    {
+        if (!module)
+            return;
+
+        SideEffectInfo effects(module);
+        for (auto *func : module->functions)
+        {
+            if (!func || func->isBuiltin || func->blocks.empty())
+                continue;
+            eliminate(func, effects);
+        }
+    }
+
+} // namespace optimize
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "Pass.hpp"
+
+namespace optimize
+{
+
+    // Mark-sweep dead code elimination (doc/DCE.md): control flow, stores
+    // and calls with side effects are live, liveness flows backwards through
+    // operands, and every instruction left unmarked is deleted.
+    class DcePass final : public Pass
+    {
+    public:
+        std::string name() const override { return "dce"; }
+        void run(IrModule *module) override;
+    };
+
+} // namespace optimize
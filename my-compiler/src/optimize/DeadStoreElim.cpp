@@ -0,0 +1,129 @@
+#include "DeadStoreElim.hpp"
+#include "AliasAnalysis.hpp"
+#include "IrUtils.hpp"
+
+#include "../midend/llvm/IrModule.hpp"
+#include "../midend/llvm/value/IrFunction.hpp"
+#include "../midend/llvm/value/IrBasicBlock.hpp"
+#include "../midend/llvm/instr/Instr.hpp"
+#include "../utils/CompileStats.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace optimize
+{
+
+    namespace
+    {
+
+        class BlockScan
+        {
+        public:
+            BlockScan(IrFunction *func, IrBasicBlock *bb, const AliasAnalysis &aa) : bb(bb), aa(aa)
+            {
+                Instr *term = terminator(bb);
+                atExit = term && term->instrType == InstrType::RET;
+                exitEndsProgram = atExit && func->name == "@main";
+            }
+
+            int run()
+            {
+                int removed = 0;
+                for (auto it = bb->instructions.end(); it != bb->instructions.begin();)
+                {
+                    --it;
+                    Instr *instr = *it;
+                    switch (instr->instrType)
+                    {
+                    case InstrType::STORE:
+                        if (isDead(instr))
+                        {
+                            detachOperands(instr);
+                            it = bb->instructions.erase(it);
+                            ++removed;
+                            continue;
+                        }
+                        overwritten.push_back(instr);
+                        break;
+                    case InstrType::LOAD:
+                        forget([&](Instr *s) { return aa.mayAlias(s->getOperand(1), instr->getOperand(0)); });
+                        loadsLater.push_back(instr->getOperand(0));
+                        break;
+                    case InstrType::CALL:
+                        forget([&](Instr *s) { return aa.callMayRead(instr, s->getOperand(1)); });
+                        callsLater.push_back(instr);
+                        break;
+                    default:
+                        break;
+                    }
+                }
+                return removed;
+            }
+
+        private:
+            IrBasicBlock *bb;
+            const AliasAnalysis &aa;
+            bool atExit;
+            bool exitEndsProgram;
+
+            // Stores further down the block nothing has read since.
+            std::vector<Instr *> overwritten;
+            // Everything below the current point that may read memory.
+            std::vector<IrValue *> loadsLater;
+            std::vector<Instr *> callsLater;
+
+            template <typename Pred>
+            void forget(Pred pred)
+            {
+                overwritten.erase(std::remove_if(overwritten.begin(), overwritten.end(), pred), overwritten.end());
+            }
+
+            bool isDead(Instr *store) const
+            {
+                IrValue *ptr = store->getOperand(1);
+                IrType *type = store->getOperand(0)->type;
+                for (auto *later : overwritten)
+                {
+                    if (later->getOperand(0)->type == type && aa.mustAlias(later->getOperand(1), ptr))
+                        return true;
+                }
+                if (!atExit || !(exitEndsProgram || aa.isPrivate(pointerBase(ptr))))
+                    return false;
+                for (auto *load : loadsLater)
+                {
+                    if (aa.mayAlias(load, ptr))
+                        return false;
+                }
+                for (auto *call : callsLater)
+                {
+                    if (aa.callMayRead(call, ptr))
+                        return false;
+                }
+                return true;
+            }
+        };
+
+    } // namespace
+
+    void DeadStoreElimPass::run(IrModule *module)
+    {
+        if (!module)
+            return;
+
+        AliasAnalysis aa(module);
+        int removed = 0;
+        for (auto *func : module->functions)
+        {
+            if (!func || func->isBuiltin || func->blocks.empty())
+                continue;
+            for (auto *bb : func->blocks)
+            {
+                BlockScan scan(func, bb, aa);
+                removed += scan.run();
+            }
+        }
+        CompileStats::Record("dse", "stores removed: " + std::to_string(removed));
+    }
+
+} // namespace optimize
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "Pass.hpp"
+
+namespace optimize
+{
+
+    // Dead store elimination. Scans each block backwards: a store is dead
+    // when a later store in the block overwrites the same location with
+    // nothing reading it in between, or when the block returns and nothing
+    // can observe the location afterwards (a non-escaping local, or any
+    // memory once main returns).
+    class DeadStoreElimPass final : public Pass
+    {
+    public:
+        std::string name() const override { return "dse"; }
+        void run(IrModule *module) override;
+    };
+
+} // namespace optimize
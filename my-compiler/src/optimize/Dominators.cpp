@@ -0,0 +1,148 @@
+#include "Dominators.hpp"
+#include "IrUtils.hpp"
+
+#include "../midend/llvm/value/IrFunction.hpp"
+#include "../midend/llvm/value/IrBasicBlock.hpp"
+
+#include <unordered_set>
+#include <utility>
+
+namespace optimize
+{
+
+    DominatorTree::DominatorTree(IrFunction *func)
+    {
+        if (func->blocks.empty())
+            return;
+
+        // Postorder by an iterative DFS, then reversed.
+        std::vector<IrBasicBlock *> postorder;
+        std::unordered_set<IrBasicBlock *> seen;
+        std::vector<std::pair<IrBasicBlock *, size_t>> stack;
+        std::unordered_map<IrBasicBlock *, std::vector<IrBasicBlock *>> succs;
+        IrBasicBlock *entry = func->blocks.front();
+        seen.insert(entry);
+        stack.push_back({entry, 0});
+        succs[entry] = successors(entry);
+        while (!stack.empty())
+        {
+            auto &[bb, next] = stack.back();
+            const auto &out = succs[bb];
+            if (next < out.size())
+            {
+                IrBasicBlock *s = out[next++];
+                if (seen.insert(s).second)
+                {
+                    succs[s] = successors(s);
+                    stack.push_back({s, 0});
+                }
+                continue;
+            }
+            postorder.push_back(bb);
+            stack.pop_back();
+        }
+        rpo.assign(postorder.rbegin(), postorder.rend());
+        for (size_t i = 0; i < rpo.size(); ++i)
+            index[rpo[i]] = (int)i;
+
+        const int n = (int)rpo.size();
+        preds.assign(n, {});
+        for (auto *bb : rpo)
+        {
+            for (auto *s : succs[bb])
+                preds[index[s]].push_back(bb);
+        }
+
+        idoms.assign(n, -2); // -2: not processed yet
+        idoms[0] = 0;
+        auto intersect = [&](int a, int b)
+        {
+            while (a != b)
+            {
+                while (a > b)
+                    a = idoms[a];
+                while (b > a)
+                    b = idoms[b];
+            }
+            return a;
+        };
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+            for (int i = 1; i < n; ++i)
+            {
+                int newIdom = -2;
+                for (auto *p : preds[i])
+                {
+                    int pi = index[p];
+                    if (idoms[pi] == -2)
+                        continue;
+                    newIdom = newIdom == -2 ? pi : intersect(pi, newIdom);
+                }
+                if (newIdom != idoms[i])
+                {
+                    idoms[i] = newIdom;
+                    changed = true;
+                }
+            }
+        }
+        idoms[0] = -1;
+
+        kids.assign(n, {});
+        for (int i = 1; i < n; ++i)
+            kids[idoms[i]].push_back(rpo[i]);
+
+        // Pre/post numbers answer dominance queries in constant time.
+        pre.assign(n, 0);
+        post.assign(n, 0);
+        int clock = 0;
+        std::vector<std::pair<int, size_t>> walk = {{0, 0}};
+        pre[0] = clock++;
+        while (!walk.empty())
+        {
+            auto &[v, next] = walk.back();
+            if (next < kids[v].size())
+            {
+                int c = index[kids[v][next++]];
+                pre[c] = clock++;
+                walk.push_back({c, 0});
+                continue;
+            }
+            post[v] = clock++;
+            walk.pop_back();
+        }
+    }
+
+    IrBasicBlock *DominatorTree::idom(IrBasicBlock *bb) const
+    {
+        auto it = index.find(bb);
+        if (it == index.end() || idoms[it->second] < 0)
+            return nullptr;
+        return rpo[idoms[it->second]];
+    }
+
+    const std::vector<IrBasicBlock *> &DominatorTree::children(IrBasicBlock *bb) const
+    {
+        static const std::vector<IrBasicBlock *> none;
+        auto it = index.find(bb);
+        return it == index.end() ? none : kids[it->second];
+    }
+
+    const std::vector<IrBasicBlock *> &DominatorTree::predecessors(IrBasicBlock *bb) const
+    {
+        static const std::vector<IrBasicBlock *> none;
+        auto it = index.find(bb);
+        return it == index.end() ? none : preds[it->second];
+    }
+
+    bool DominatorTree::dominates(IrBasicBlock *a, IrBasicBlock *b) const
+    {
+        auto ia = index.find(a);
+        auto ib = index.find(b);
+        if (ia == index.end() || ib == index.end())
+            return false;
+        return pre[ia->second] <= pre[ib->second] && post[ib->second] <= post[ia->second];
+    }
+
+} // namespace optimize
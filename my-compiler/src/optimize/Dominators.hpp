@@ -0,0 +1,42 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+class IrFunction;
+class IrBasicBlock;
+
+namespace optimize
+{
+
+    // Dominator tree of the blocks reachable from the entry, computed with
+    // the Cooper-Harvey-Kennedy iteration over reverse postorder.
+    class DominatorTree
+    {
+    public:
+        explicit DominatorTree(IrFunction *func);
+
+        // Reachable blocks in reverse postorder; the entry comes first.
+        const std::vector<IrBasicBlock *> &order() const { return rpo; }
+
+        bool isReachable(IrBasicBlock *bb) const { return index.count(bb) != 0; }
+
+        // nullptr for the entry block.
+        IrBasicBlock *idom(IrBasicBlock *bb) const;
+
+        const std::vector<IrBasicBlock *> &children(IrBasicBlock *bb) const;
+
+        const std::vector<IrBasicBlock *> &predecessors(IrBasicBlock *bb) const;
+
+        bool dominates(IrBasicBlock *a, IrBasicBlock *b) const;
+
+    private:
+        std::vector<IrBasicBlock *> rpo;
+        std::unordered_map<IrBasicBlock *, int> index; // position in rpo
+        std::vector<int> idoms;                        // by rpo index, -1 for the entry
+        std::vector<std::vector<IrBasicBlock *>> kids;
+        std::vector<std::vector<IrBasicBlock *>> preds;
+        std::vector<int> pre, post; // dominator tree DFS numbering
+    };
+
+} // namespace optimize
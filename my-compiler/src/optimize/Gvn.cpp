@@ -0,0 +1,231 @@
+#include "Gvn.hpp"
+#include "Dominators.hpp"
+#include "IrUtils.hpp"
+
+#include "../midend/llvm/IrModule.hpp"
+#include "../midend/llvm/value/IrFunction.hpp"
+#include "../midend/llvm/value/IrBasicBlock.hpp"
+#include "../midend/llvm/value/IrConstantInt.hpp"
+#include "../midend/llvm/instr/IcmpInstr.hpp"
+#include "../utils/CompileStats.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace optimize
+{
+
+    namespace
+    {
+
+        std::string operandKey(IrValue *v)
+        {
+            if (auto *c = dynamic_cast<IrConstantInt *>(v))
+                return "#" + std::to_string(c->value);
+            return "%" + std::to_string((uintptr_t)v);
+        }
+
+        // Hash key for a pure instruction, or "" if it must not be merged.
+        // Operands of commutative operations are sorted, and sgt/sge are
+        // written as slt/sle with the operands swapped.
+        std::string valueKey(Instr *instr)
+        {
+            std::vector<std::string> ops;
+            for (auto *use : instr->operandList)
+                ops.push_back(operandKey(use->value));
+
+            std::string head;
+            switch (instr->instrType)
+            {
+            case InstrType::ADD:
+            case InstrType::MUL:
+                std::sort(ops.begin(), ops.end());
+                head = instr->instrType == InstrType::ADD ? "add" : "mul";
+                break;
+            case InstrType::SUB:
+                head = "sub";
+                break;
+            case InstrType::SDIV:
+                head = "sdiv";
+                break;
+            case InstrType::SREM:
+                head = "srem";
+                break;
+            case InstrType::ICMP:
+                switch (static_cast<IcmpInstr *>(instr)->cond)
+                {
+                case IcmpCond::EQ:
+                    head = "eq";
+                    std::sort(ops.begin(), ops.end());
+                    break;
+                case IcmpCond::NE:
+                    head = "ne";
+                    std::sort(ops.begin(), ops.end());
+                    break;
+                case IcmpCond::SLT:
+                    head = "slt";
+                    break;
+                case IcmpCond::SLE:
+                    head = "sle";
+                    break;
+                case IcmpCond::SGT:
+                    head = "slt";
+                    std::swap(ops[0], ops[1]);
+                    break;
+                case IcmpCond::SGE:
+                    head = "sle";
+                    std::swap(ops[0], ops[1]);
+                    break;
+                }
+                break;
+            case InstrType::GEP:
+                head = "gep";
+                break;
+            case InstrType::ZEXT:
+                head = "zext" + instr->type->toString();
+                break;
+            default:
+                return "";
+            }
+
+            std::string key = head;
+            for (auto &op : ops)
+                key += " " + op;
+            return key;
+        }
+
+        // (x + c1) + c2 is also x + (c1 + c2): the key under which an
+        // unrolled body's i + 1 meets the next copy's i. "" if `instr` is
+        // not of that shape.
+        std::string reassociatedKey(Instr *instr)
+        {
+            if (instr->instrType != InstrType::ADD)
+                return "";
+            for (int i = 0; i < 2; ++i)
+            {
+                auto *outer = dynamic_cast<IrConstantInt *>(instr->getOperand(1 - i));
+                auto *inner = dynamic_cast<Instr *>(instr->getOperand(i));
+                if (!outer || !inner || inner->instrType != InstrType::ADD)
+                    continue;
+                for (int k = 0; k < 2; ++k)
+                {
+                    auto *c = dynamic_cast<IrConstantInt *>(inner->getOperand(1 - k));
+                    if (!c || dynamic_cast<IrConstantInt *>(inner->getOperand(k)))
+                        continue;
+                    int sum = (int)((uint32_t)c->value + (uint32_t)outer->value);
+                    std::vector<std::string> ops = {operandKey(inner->getOperand(k)), "#" + std::to_string(sum)};
+                    std::sort(ops.begin(), ops.end());
+                    return "add " + ops[0] + " " + ops[1];
+                }
+            }
+            return "";
+        }
+
+        // x + 0, x - 0, x * 1 and x / 1 are x itself.
+        IrValue *identityOperand(Instr *instr)
+        {
+            auto isConst = [](IrValue *v, int c)
+            {
+                auto *ci = dynamic_cast<IrConstantInt *>(v);
+                return ci && ci->value == c;
+            };
+            switch (instr->instrType)
+            {
+            case InstrType::ADD:
+                if (isConst(instr->getOperand(0), 0))
+                    return instr->getOperand(1);
+                return isConst(instr->getOperand(1), 0) ? instr->getOperand(0) : nullptr;
+            case InstrType::MUL:
+                if (isConst(instr->getOperand(0), 1))
+                    return instr->getOperand(1);
+                return isConst(instr->getOperand(1), 1) ? instr->getOperand(0) : nullptr;
+            case InstrType::SUB:
+                return isConst(instr->getOperand(1), 0) ? instr->getOperand(0) : nullptr;
+            case InstrType::SDIV:
+                return isConst(instr->getOperand(1), 1) ? instr->getOperand(0) : nullptr;
+            default:
+                return nullptr;
+            }
+        }
+
+        class Numbering
+        {
+        public:
+            int removed = 0;
+
+            explicit Numbering(const DominatorTree &dt) : dt(dt) {}
+
+            void visit(IrBasicBlock *bb)
+            {
+                std::vector<std::string> added;
+                for (auto it = bb->instructions.begin(); it != bb->instructions.end();)
+                {
+                    Instr *instr = *it;
+                    IrValue *same = identityOperand(instr);
+                    std::string key = same ? "" : valueKey(instr);
+                    if (!same && !key.empty())
+                    {
+                        std::string alias = reassociatedKey(instr);
+                        auto found = table.find(key);
+                        if (found == table.end() && !alias.empty())
+                            found = table.find(alias);
+                        if (found != table.end())
+                            same = found->second;
+                        else
+                        {
+                            table.emplace(key, instr);
+                            added.push_back(key);
+                            if (!alias.empty())
+                            {
+                                table.emplace(alias, instr);
+                                added.push_back(alias);
+                            }
+                        }
+                    }
+                    if (!same)
+                    {
+                        ++it;
+                        continue;
+                    }
+                    instr->replaceAllUsesWith(same);
+                    detachOperands(instr);
+                    it = bb->instructions.erase(it);
+                    ++removed;
+                }
+
+                for (auto *child : dt.children(bb))
+                    visit(child);
+
+                for (auto &key : added)
+                    table.erase(key);
+            }
+
+        private:
+            const DominatorTree &dt;
+            std::unordered_map<std::string, Instr *> table;
+        };
+
+    } // namespace
+
+    void GvnPass::run(IrModule *module)
+    {
+        if (!module)
+            return;
+
+        int removed = 0;
+        for (auto *func : module->functions)
+        {
+            if (!func || func->isBuiltin || func->blocks.empty())
+                continue;
+            DominatorTree dt(func);
+            Numbering numbering(dt);
+            numbering.visit(func->blocks.front());
+            removed += numbering.removed;
+        }
+        CompileStats::Record("gvn", "instructions removed: " + std::to_string(removed));
+    }
+
+} // namespace optimize
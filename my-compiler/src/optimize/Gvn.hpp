@@ -0,0 +1,18 @@
+#pragma once
+
+#include "Pass.hpp"
+
+namespace optimize
+{
+
+    // Dominator-scoped global value numbering: a pure instruction that
+    // repeats one in a dominating position, up to operand order of
+    // commutative operations, is replaced by the earlier result.
+    class GvnPass final : public Pass
+    {
+    public:
+        std::string name() const override { return "gvn"; }
+        void run(IrModule *module) override;
+    };
+
+} // namespace optimize
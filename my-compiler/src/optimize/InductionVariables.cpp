@@ -0,0 +1,74 @@
+#include "InductionVariables.hpp"
+#include "LoopInfo.hpp"
+
+#include "../midend/llvm/value/IrBasicBlock.hpp"
+#include "../midend/llvm/value/IrConstantInt.hpp"
+#include "../midend/llvm/instr/PhiInstr.hpp"
+
+namespace optimize
+{
+
+    bool matchInduction(const Loop &loop, PhiInstr *phi, InductionVariable &iv)
+    {
+        if (!loop.preheader || loop.latches.size() != 1 || !phi || phi->parentBlock != loop.header ||
+            phi->operandList.size() != 4)
+            return false;
+        IrValue *init = phi->getIncomingValue(loop.preheader);
+        auto *next = dynamic_cast<Instr *>(phi->getIncomingValue(loop.latches.front()));
+        if (!init || !next || !loop.contains(next->parentBlock))
+            return false;
+        int step = 0;
+        if (next == phi || !offsetFrom(next, phi, step))
+            return false;
+        iv.phi = phi;
+        iv.init = init;
+        iv.next = next;
+        iv.step = step;
+        return step != 0;
+    }
+
+    std::vector<InductionVariable> findInductionVariables(const Loop &loop)
+    {
+        std::vector<InductionVariable> found;
+        for (auto *instr : loop.header->instructions)
+        {
+            auto *phi = dynamic_cast<PhiInstr *>(instr);
+            if (!phi)
+                break;
+            InductionVariable iv;
+            if (matchInduction(loop, phi, iv))
+                found.push_back(iv);
+        }
+        return found;
+    }
+
+    bool offsetFrom(IrValue *v, PhiInstr *iv, int &offset)
+    {
+        // Unrolled bodies chain their increments; follow a few links.
+        offset = 0;
+        for (int depth = 0; depth < 16; ++depth)
+        {
+            if (v == iv)
+                return true;
+            auto *instr = dynamic_cast<Instr *>(v);
+            if (!instr || (instr->instrType != InstrType::ADD && instr->instrType != InstrType::SUB))
+                return false;
+            auto *lhs = dynamic_cast<IrConstantInt *>(instr->getOperand(0));
+            auto *rhs = dynamic_cast<IrConstantInt *>(instr->getOperand(1));
+            if (rhs)
+            {
+                offset += instr->instrType == InstrType::ADD ? rhs->value : -rhs->value;
+                v = instr->getOperand(0);
+            }
+            else if (lhs && instr->instrType == InstrType::ADD)
+            {
+                offset += lhs->value;
+                v = instr->getOperand(1);
+            }
+            else
+                return false;
+        }
+        return false;
+    }
+
+} // namespace optimize
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+
+class IrValue;
+class Instr;
+class PhiInstr;
+
+namespace optimize
+{
+
+    struct Loop;
+
+    // A basic induction variable: a header phi entered with `init` from the
+    // preheader and advanced by a constant on the single latch,
+    //   iv = phi [init, preheader], [next, latch];  next = iv +/- step
+    // where an unrolled loop reaches `next` through a chain of additions.
+    struct InductionVariable
+    {
+        PhiInstr *phi = nullptr;
+        IrValue *init = nullptr;
+        Instr *next = nullptr;
+        int step = 0;
+    };
+
+    // Matches `phi` against the shape above. The loop needs a preheader and
+    // exactly one latch.
+    bool matchInduction(const Loop &loop, PhiInstr *phi, InductionVariable &iv);
+
+    std::vector<InductionVariable> findInductionVariables(const Loop &loop);
+
+    // Recognises `iv` shifted by constants (`iv + c`, `c + iv`, `iv - c` and
+    // chains of them), giving the total shift.
+    bool offsetFrom(IrValue *v, PhiInstr *iv, int &offset);
+
+} // namespace optimize
@@ -0,0 +1,312 @@
+#include "Inliner.hpp"
+#include "Dominators.hpp"
+#include "IrUtils.hpp"
+#include "LoopInfo.hpp"
+
+#include "../midend/llvm/IrModule.hpp"
+#include "../midend/llvm/value/IrFunction.hpp"
+#include "../midend/llvm/value/IrBasicBlock.hpp"
+#include "../midend/llvm/value/IrConstantInt.hpp"
+#include "../midend/llvm/type/IrBaseType.hpp"
+#include "../midend/llvm/instr/JumpInstr.hpp"
+#include "../midend/llvm/instr/PhiInstr.hpp"
+#include "../utils/CompileStats.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace optimize
+{
+
+    namespace
+    {
+
+        // Cost model, in IR instructions of the callee.
+        constexpr int kBaseBudget = 30;
+        constexpr int kConstantArgBonus = 10;
+        constexpr int kLoopBonus = 60;          // per loop level, up to two
+        constexpr int kSingleCallerBudget = 400; // the body moves, nothing is copied
+        constexpr int kMaxCallerSize = 4000;
+
+        IrFunction *userCallee(Instr *instr)
+        {
+            if (instr->instrType != InstrType::CALL)
+                return nullptr;
+            auto *callee = dynamic_cast<IrFunction *>(instr->getOperand(0));
+            return callee && !callee->isBuiltin && !callee->blocks.empty() ? callee : nullptr;
+        }
+
+        int sizeOf(IrFunction *func)
+        {
+            int size = 0;
+            for (auto *bb : func->blocks)
+            {
+                for (auto *instr : bb->instructions)
+                {
+                    if (instr->instrType != InstrType::PHI && instr->instrType != InstrType::ALLOCA)
+                        ++size;
+                }
+            }
+            return size;
+        }
+
+        int callSiteCount(IrFunction *func)
+        {
+            int count = 0;
+            for (auto *use : func->useList)
+            {
+                auto *instr = dynamic_cast<Instr *>(use->user);
+                if (instr && instr->instrType == InstrType::CALL && instr->getOperand(0) == func)
+                    ++count;
+            }
+            return count;
+        }
+
+        // Strongly connected components of the call graph, callees first
+        // (Tarjan emits an SCC only after everything it reaches).
+        std::vector<std::vector<IrFunction *>> bottomUpSccs(IrModule *module)
+        {
+            std::unordered_map<IrFunction *, int> index, low;
+            std::unordered_set<IrFunction *> onStack;
+            std::vector<IrFunction *> stack;
+            std::vector<std::vector<IrFunction *>> sccs;
+            int counter = 0;
+
+            std::function<void(IrFunction *)> connect = [&](IrFunction *f)
+            {
+                index[f] = low[f] = counter++;
+                stack.push_back(f);
+                onStack.insert(f);
+                for (auto *bb : f->blocks)
+                {
+                    for (auto *instr : bb->instructions)
+                    {
+                        IrFunction *g = userCallee(instr);
+                        if (!g)
+                            continue;
+                        if (!index.count(g))
+                        {
+                            connect(g);
+                            low[f] = std::min(low[f], low[g]);
+                        }
+                        else if (onStack.count(g))
+                            low[f] = std::min(low[f], index[g]);
+                    }
+                }
+                if (low[f] != index[f])
+                    return;
+                sccs.emplace_back();
+                IrFunction *g;
+                do
+                {
+                    g = stack.back();
+                    stack.pop_back();
+                    onStack.erase(g);
+                    sccs.back().push_back(g);
+                } while (g != f);
+            };
+
+            for (auto *f : module->functions)
+            {
+                if (!f->isBuiltin && !index.count(f))
+                    connect(f);
+            }
+            return sccs;
+        }
+
+        class Inliner
+        {
+        public:
+            int inlined = 0;
+
+            // Copies `callee` in place of `call`: the call's block is split
+            // after the call, the copy sits between the two halves, and each
+            // return becomes a jump to the second half.
+            void inlineCall(IrFunction *caller, Instr *call, IrFunction *callee)
+            {
+                const std::string tag = "_i" + std::to_string(++inlined);
+                IrBasicBlock *bb = call->parentBlock;
+
+                auto *after = new IrBasicBlock(bb->name + tag + "_cont", caller);
+                auto pos = std::find(bb->instructions.begin(), bb->instructions.end(), call);
+                after->instructions.splice(after->instructions.end(), bb->instructions, std::next(pos),
+                                           bb->instructions.end());
+                for (auto *instr : after->instructions)
+                    instr->parentBlock = after;
+                for (auto *succ : successors(after))
+                {
+                    for (auto *instr : succ->instructions)
+                    {
+                        auto *phi = dynamic_cast<PhiInstr *>(instr);
+                        if (!phi)
+                            break;
+                        phi->replaceIncomingBlock(bb, after);
+                    }
+                }
+
+                std::unordered_map<IrValue *, IrValue *> map;
+                for (size_t i = 0; i < callee->params.size(); ++i)
+                    map[callee->params[i]] = call->getOperand((int)i + 1);
+
+                std::vector<IrBasicBlock *> copies;
+                for (auto *src : callee->blocks)
+                {
+                    auto *copy = new IrBasicBlock(src->name + tag, caller);
+                    map[src] = copy;
+                    copies.push_back(copy);
+                }
+
+                IrBasicBlock *entry = caller->blocks.front();
+                std::vector<Instr *> clones;
+                std::vector<std::pair<Instr *, IrBasicBlock *>> returns;
+                auto copyIt = copies.begin();
+                for (auto *src : callee->blocks)
+                {
+                    IrBasicBlock *copy = *copyIt++;
+                    for (auto *instr : src->instructions)
+                    {
+                        Instr *clone = cloneInstr(instr, instr->name.empty() ? "" : instr->name + tag);
+                        map[instr] = clone;
+                        clones.push_back(clone);
+                        if (instr->instrType == InstrType::ALLOCA)
+                        {
+                            // Frame objects stay in the entry block.
+                            clone->parentBlock = entry;
+                            entry->instructions.push_front(clone);
+                            continue;
+                        }
+                        clone->parentBlock = copy;
+                        copy->instructions.push_back(clone);
+                        if (instr->instrType == InstrType::RET)
+                            returns.push_back({clone, copy});
+                    }
+                }
+                for (auto *clone : clones)
+                    remapOperands(clone, map);
+
+                // Returns become jumps to the continuation; the call's value
+                // is the returned one, merged by a phi if there are several.
+                IrValue *result = nullptr;
+                PhiInstr *merge = nullptr;
+                if (!call->type->isVoid() && returns.size() > 1)
+                {
+                    merge = new PhiInstr(call->type, call->name + tag);
+                    merge->parentBlock = after;
+                    after->instructions.push_front(merge);
+                    result = merge;
+                }
+                for (auto &[ret, from] : returns)
+                {
+                    if (!call->type->isVoid() && !ret->operandList.empty())
+                    {
+                        if (merge)
+                            merge->addIncoming(ret->getOperand(0), from);
+                        else
+                            result = ret->getOperand(0);
+                    }
+                    detachOperands(ret);
+                    from->instructions.remove(ret);
+                    auto *jump = new JumpInstr(after);
+                    jump->parentBlock = from;
+                    from->instructions.push_back(jump);
+                }
+                if (!call->type->isVoid())
+                    call->replaceAllUsesWith(result ? result : IrConstantInt::get(0));
+
+                detachOperands(call);
+                bb->instructions.remove(call);
+                auto *jump = new JumpInstr(copies.front());
+                jump->parentBlock = bb;
+                bb->instructions.push_back(jump);
+
+                auto at = std::next(std::find(caller->blocks.begin(), caller->blocks.end(), bb));
+                caller->blocks.insert(at, copies.begin(), copies.end());
+                caller->blocks.insert(at, after);
+            }
+        };
+
+        void deleteFunction(IrModule *module, IrFunction *func)
+        {
+            for (auto *bb : func->blocks)
+            {
+                for (auto *instr : bb->instructions)
+                    detachOperands(instr);
+            }
+            func->blocks.clear();
+            module->functions.erase(std::find(module->functions.begin(), module->functions.end(), func));
+        }
+
+    } // namespace
+
+    void InlinePass::run(IrModule *module)
+    {
+        if (!module)
+            return;
+
+        Inliner inliner;
+        for (auto &scc : bottomUpSccs(module))
+        {
+            std::unordered_set<IrFunction *> sameScc(scc.begin(), scc.end());
+            for (auto *caller : scc)
+            {
+                refreshParentBlocks(caller);
+
+                DominatorTree dt(caller);
+                LoopInfo loops(caller, dt);
+
+                // Decide every call site against the caller as it is now;
+                // inlining one does not change how the others are judged.
+                std::vector<std::pair<Instr *, IrFunction *>> chosen;
+                int callerSize = sizeOf(caller);
+                for (auto *bb : caller->blocks)
+                {
+                    Loop *loop = loops.loopFor(bb);
+                    int depth = loop ? std::min(loop->depth, 2) : 0;
+                    for (auto *instr : bb->instructions)
+                    {
+                        IrFunction *callee = userCallee(instr);
+                        if (!callee || sameScc.count(callee) || callee->name == "@main")
+                            continue;
+                        int size = sizeOf(callee);
+                        int budget = kBaseBudget + depth * kLoopBonus;
+                        for (size_t i = 1; i < instr->operandList.size(); ++i)
+                        {
+                            if (dynamic_cast<IrConstantInt *>(instr->getOperand((int)i)))
+                                budget += kConstantArgBonus;
+                        }
+                        if (callSiteCount(callee) == 1)
+                            budget = std::max(budget, kSingleCallerBudget);
+                        if (size > budget || callerSize + size > kMaxCallerSize)
+                            continue;
+                        callerSize += size;
+                        chosen.push_back({instr, callee});
+                    }
+                }
+                for (auto &[call, callee] : chosen)
+                    inliner.inlineCall(caller, call, callee);
+            }
+        }
+
+        // Functions nobody calls any more.
+        bool changed = true;
+        int deleted = 0;
+        while (changed)
+        {
+            changed = false;
+            for (auto *func : std::vector<IrFunction *>(module->functions))
+            {
+                if (func->isBuiltin || func->name == "@main" || callSiteCount(func) != 0)
+                    continue;
+                deleteFunction(module, func);
+                ++deleted;
+                changed = true;
+            }
+        }
+        CompileStats::Record("inline", "call sites inlined: " + std::to_string(inliner.inlined) +
+                                           ", functions deleted: " + std::to_string(deleted));
+    }
+
+} // namespace optimize
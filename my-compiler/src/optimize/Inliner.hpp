@@ -0,0 +1,20 @@
+#pragma once
+
+#include "Pass.hpp"
+
+namespace optimize
+{
+
+    // Inlines calls to user functions, callees before callers over the call
+    // graph. A call site is inlined when the callee's size is within a
+    // budget that grows for constant arguments, for call sites inside loops
+    // and for functions called from a single place. Functions left without
+    // callers are deleted afterwards.
+    class InlinePass final : public Pass
+    {
+    public:
+        std::string name() const override { return "inline"; }
+        void run(IrModule *module) override;
+    };
+
+} // namespace optimize
@@ -0,0 +1,193 @@
+#include "IrUtils.hpp"
+
+#include "../midend/llvm/value/IrBasicBlock.hpp"
+#include "../midend/llvm/type/IrBaseType.hpp"
+#include "../midend/llvm/value/IrFunction.hpp"
+#include "../midend/llvm/instr/AllocaInstr.hpp"
+#include "../midend/llvm/instr/AluInstr.hpp"
+#include "../midend/llvm/instr/BranchInstr.hpp"
+#include "../midend/llvm/instr/CallInstr.hpp"
+#include "../midend/llvm/instr/GepInstr.hpp"
+#include "../midend/llvm/instr/IcmpInstr.hpp"
+#include "../midend/llvm/instr/JumpInstr.hpp"
+#include "../midend/llvm/instr/LoadInstr.hpp"
+#include "../midend/llvm/instr/PhiInstr.hpp"
+#include "../midend/llvm/instr/ReturnInstr.hpp"
+#include "../midend/llvm/instr/StoreInstr.hpp"
+#include "../midend/llvm/instr/TruncInstr.hpp"
+#include "../midend/llvm/instr/ZextInstr.hpp"
+
+#include <algorithm>
+
+namespace optimize
+{
+
+    Instr *terminator(IrBasicBlock *bb)
+    {
+        if (bb->instructions.empty())
+            return nullptr;
+        Instr *last = bb->instructions.back();
+        switch (last->instrType)
+        {
+        case InstrType::BR:
+        case InstrType::JUMP:
+        case InstrType::RET:
+            return last;
+        default:
+            return nullptr;
+        }
+    }
+
+    void refreshParentBlocks(IrFunction *func)
+    {
+        for (auto *bb : func->blocks)
+        {
+            for (auto *instr : bb->instructions)
+                instr->parentBlock = bb;
+        }
+    }
+
+    std::vector<IrBasicBlock *> successors(IrBasicBlock *bb)
+    {
+        std::vector<IrBasicBlock *> result;
+        Instr *term = terminator(bb);
+        if (!term)
+            return result;
+        for (auto *use : term->operandList)
+        {
+            auto *target = dynamic_cast<IrBasicBlock *>(use->value);
+            if (target && std::find(result.begin(), result.end(), target) == result.end())
+                result.push_back(target);
+        }
+        return result;
+    }
+
+    void detachOperands(Instr *instr)
+    {
+        for (auto *use : instr->operandList)
+        {
+            if (use && use->value)
+                use->value->useList.remove(use);
+        }
+    }
+
+    Instr *cloneInstr(Instr *instr, const std::string &name)
+    {
+        auto op = [&](int i)
+        { return instr->getOperand(i); };
+        auto block = [&](int i)
+        { return static_cast<IrBasicBlock *>(instr->getOperand(i)); };
+
+        switch (instr->instrType)
+        {
+        case InstrType::ADD:
+        case InstrType::SUB:
+        case InstrType::MUL:
+        case InstrType::SDIV:
+        case InstrType::SREM:
+            return new AluInstr(instr->instrType, op(0), op(1), name);
+        case InstrType::ICMP:
+            return new IcmpInstr(static_cast<IcmpInstr *>(instr)->cond, op(0), op(1), name);
+        case InstrType::ALLOCA:
+            return new AllocaInstr(static_cast<AllocaInstr *>(instr)->allocatedType, name);
+        case InstrType::LOAD:
+            return new LoadInstr(op(0), name);
+        case InstrType::STORE:
+            return new StoreInstr(op(0), op(1));
+        case InstrType::BR:
+            return new BranchInstr(op(0), block(1), block(2));
+        case InstrType::JUMP:
+            return new JumpInstr(block(0));
+        case InstrType::RET:
+            return new ReturnInstr(instr->operandList.empty() ? nullptr : op(0));
+        case InstrType::CALL:
+        {
+            std::vector<IrValue *> args;
+            for (size_t i = 1; i < instr->operandList.size(); ++i)
+                args.push_back(op((int)i));
+            return new CallInstr(static_cast<IrFunction *>(op(0)), args, name);
+        }
+        case InstrType::GEP:
+        {
+            std::vector<IrValue *> indices;
+            for (size_t i = 1; i < instr->operandList.size(); ++i)
+                indices.push_back(op((int)i));
+            return new GepInstr(op(0), indices, name);
+        }
+        case InstrType::ZEXT:
+            return new ZextInstr(op(0), instr->type, name);
+        case InstrType::TRUNC:
+            return new TruncInstr(op(0), instr->type, name);
+        case InstrType::PHI:
+        {
+            auto *phi = new PhiInstr(instr->type, name);
+            for (size_t i = 0; i + 1 < instr->operandList.size(); i += 2)
+                phi->addIncoming(op((int)i), block((int)i + 1));
+            return phi;
+        }
+        }
+        return nullptr;
+    }
+
+    void remapOperands(Instr *instr, const std::unordered_map<IrValue *, IrValue *> &map)
+    {
+        for (size_t i = 0; i < instr->operandList.size(); ++i)
+        {
+            auto it = map.find(instr->getOperand((int)i));
+            if (it != map.end())
+                instr->setOperand((int)i, it->second);
+        }
+    }
+
+    std::string freshBlockName(IrFunction *func, const std::string &base)
+    {
+        auto taken = [&](const std::string &name)
+        {
+            return std::any_of(func->blocks.begin(), func->blocks.end(), [&](IrBasicBlock *bb)
+                               { return bb->name == name; });
+        };
+        std::string name = base;
+        for (int n = 1; taken(name); ++n)
+            name = base + std::to_string(n);
+        return name;
+    }
+
+    IcmpCond swappedCond(IcmpCond cond)
+    {
+        switch (cond)
+        {
+        case IcmpCond::SGT:
+            return IcmpCond::SLT;
+        case IcmpCond::SGE:
+            return IcmpCond::SLE;
+        case IcmpCond::SLT:
+            return IcmpCond::SGT;
+        case IcmpCond::SLE:
+            return IcmpCond::SGE;
+        default:
+            return cond;
+        }
+    }
+
+    void removePhiIncoming(IrBasicBlock *bb, IrBasicBlock *from)
+    {
+        for (auto *instr : bb->instructions)
+        {
+            if (instr->instrType != InstrType::PHI)
+                break;
+            auto &ops = instr->operandList;
+            for (size_t i = 0; i + 1 < ops.size();)
+            {
+                if (ops[i + 1]->value != from)
+                {
+                    i += 2;
+                    continue;
+                }
+                ops[i]->value->useList.remove(ops[i]);
+                ops[i + 1]->value->useList.remove(ops[i + 1]);
+                ops.erase(ops.begin() + i, ops.begin() + i + 2);
+            }
+        }
+    }
+
+} // namespace optimize
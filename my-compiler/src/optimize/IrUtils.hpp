@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class IrBasicBlock;
+class IrFunction;
+class IrValue;
+class Instr;
+enum class IcmpCond;
+
+namespace optimize
+{
+
+    // Small CFG and use-list helpers shared by the passes.
+
+    Instr *terminator(IrBasicBlock *bb);
+
+    // Points every instruction's parentBlock at the block that holds it.
+    // Passes that move or create instructions do not always keep it set.
+    void refreshParentBlocks(IrFunction *func);
+
+    // Distinct successors in branch operand order.
+    std::vector<IrBasicBlock *> successors(IrBasicBlock *bb);
+
+    // Drops the instruction's uses of its operands. The instruction itself is
+    // left where it is; callers erase it from its block.
+    void detachOperands(Instr *instr);
+
+    // Copy of `instr` with the same operands, not yet in any block.
+    Instr *cloneInstr(Instr *instr, const std::string &name);
+
+    // Replaces every operand found in `map` by its image.
+    void remapOperands(Instr *instr, const std::unordered_map<IrValue *, IrValue *> &map);
+
+    // `base`, or `base` with a numeric suffix if a block of that name
+    // exists; labels are emitted by name and must not collide.
+    std::string freshBlockName(IrFunction *func, const std::string &base);
+
+    // The condition that holds for (b, a) exactly when `cond` holds for
+    // (a, b).
+    IcmpCond swappedCond(IcmpCond cond);
+
+    // Removes the incoming pair for `from` from every phi at the top of `bb`.
+    void removePhiIncoming(IrBasicBlock *bb, IrBasicBlock *from);
+
+} // namespace optimize
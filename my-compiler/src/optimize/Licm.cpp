@@ -0,0 +1,196 @@
+#include "Licm.hpp"
+#include "Dominators.hpp"
+#include "IrUtils.hpp"
+#include "LoopInfo.hpp"
+#include "AliasAnalysis.hpp"
+
+#include "../midend/llvm/IrModule.hpp"
+#include "../midend/llvm/value/IrFunction.hpp"
+#include "../midend/llvm/value/IrBasicBlock.hpp"
+#include "../midend/llvm/value/IrConstantInt.hpp"
+#include "../midend/llvm/type/IrPointerType.hpp"
+#include "../midend/llvm/instr/Instr.hpp"
+#include "../utils/CompileStats.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace optimize
+{
+
+    namespace
+    {
+
+        // A load that may run before the loop even when the loop body would
+        // not: a global or local object with constant, in-bounds indices.
+        bool isSafeToSpeculate(IrValue *ptr)
+        {
+            IrValue *base = pointerBase(ptr);
+            long long offset;
+            if (!isIdentifiedObject(base) || !constantOffset(ptr, offset))
+                return false;
+            long long objectSize = sizeOf(static_cast<IrPointerType *>(base->type)->pointedType);
+            long long loadSize = sizeOf(static_cast<IrPointerType *>(ptr->type)->pointedType);
+            return offset >= 0 && offset + loadSize <= objectSize;
+        }
+
+        class Hoister
+        {
+        public:
+            int hoisted = 0;
+
+            Hoister(Loop *loop, const DominatorTree &dt, const AliasAnalysis &aa)
+                : loop(loop), dt(dt), aa(aa)
+            {
+                for (auto *bb : loop->blocks)
+                {
+                    for (auto *instr : bb->instructions)
+                    {
+                        if (instr->instrType == InstrType::STORE)
+                            stores.push_back(instr->getOperand(1));
+                        else if (instr->instrType == InstrType::CALL)
+                            calls.push_back(instr);
+                    }
+                }
+                exiting = loop->exitingBlocks();
+            }
+
+            void run()
+            {
+                IrBasicBlock *pre = loop->preheader;
+                for (auto *bb : loop->blocks)
+                {
+                    for (auto it = bb->instructions.begin(); it != bb->instructions.end();)
+                    {
+                        Instr *instr = *it;
+                        if (!canHoist(instr))
+                        {
+                            ++it;
+                            continue;
+                        }
+                        it = bb->instructions.erase(it);
+                        pre->instructions.insert(std::prev(pre->instructions.end()), instr);
+                        instr->parentBlock = pre;
+                        ++hoisted;
+                    }
+                }
+            }
+
+        private:
+            Loop *loop;
+            const DominatorTree &dt;
+            const AliasAnalysis &aa;
+            std::vector<IrValue *> stores;
+            std::vector<Instr *> calls;
+            std::vector<IrBasicBlock *> exiting;
+
+            bool isInvariant(IrValue *v) const
+            {
+                auto *instr = dynamic_cast<Instr *>(v);
+                return !instr || !loop->contains(instr->parentBlock);
+            }
+
+            bool operandsInvariant(Instr *instr) const
+            {
+                for (auto *use : instr->operandList)
+                {
+                    if (!isInvariant(use->value))
+                        return false;
+                }
+                return true;
+            }
+
+            // Runs on every iteration that leaves the loop, so also on the
+            // way into it.
+            bool alwaysExecuted(IrBasicBlock *bb) const
+            {
+                for (auto *e : exiting)
+                {
+                    if (!dt.dominates(bb, e))
+                        return false;
+                }
+                return true;
+            }
+
+            bool canHoist(Instr *instr) const
+            {
+                switch (instr->instrType)
+                {
+                case InstrType::ADD:
+                case InstrType::SUB:
+                case InstrType::MUL:
+                case InstrType::ICMP:
+                case InstrType::GEP:
+                case InstrType::ZEXT:
+                case InstrType::TRUNC:
+                    return operandsInvariant(instr);
+                case InstrType::SDIV:
+                case InstrType::SREM:
+                {
+                    auto *d = dynamic_cast<IrConstantInt *>(instr->getOperand(1));
+                    return d && d->value != 0 && operandsInvariant(instr);
+                }
+                case InstrType::LOAD:
+                {
+                    IrValue *ptr = instr->getOperand(0);
+                    if (!isInvariant(ptr))
+                        return false;
+                    if (!isSafeToSpeculate(ptr) && !alwaysExecuted(instr->parentBlock))
+                        return false;
+                    for (auto *s : stores)
+                    {
+                        if (aa.mayAlias(ptr, s))
+                            return false;
+                    }
+                    for (auto *call : calls)
+                    {
+                        if (aa.callMayWrite(call, ptr))
+                            return false;
+                    }
+                    return true;
+                }
+                default:
+                    return false;
+                }
+            }
+        };
+
+    } // namespace
+
+    void LicmPass::run(IrModule *module)
+    {
+        if (!module)
+            return;
+
+        AliasAnalysis aa(module);
+        int hoisted = 0;
+        for (auto *func : module->functions)
+        {
+            if (!func || func->isBuiltin || func->blocks.empty())
+                continue;
+            refreshParentBlocks(func);
+
+            auto dt = std::make_unique<DominatorTree>(func);
+            auto loops = std::make_unique<LoopInfo>(func, *dt);
+            if (ensurePreheaders(func, *loops, *dt))
+            {
+                dt = std::make_unique<DominatorTree>(func);
+                loops = std::make_unique<LoopInfo>(func, *dt);
+            }
+
+            // Inner loops first: what leaves them lands in a block of the
+            // enclosing loop and may move further out.
+            const auto &order = loops->loops();
+            for (auto it = order.rbegin(); it != order.rend(); ++it)
+            {
+                if (!(*it)->preheader)
+                    continue;
+                Hoister hoister(*it, *dt, aa);
+                hoister.run();
+                hoisted += hoister.hoisted;
+            }
+        }
+        CompileStats::Record("licm", "instructions hoisted: " + std::to_string(hoisted));
+    }
+
+} // namespace optimize
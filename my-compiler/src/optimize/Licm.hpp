@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Pass.hpp"
+
+namespace optimize
+{
+
+    // Loop-invariant code motion. Every loop gets a preheader; pure
+    // instructions whose operands are defined outside the loop move there,
+    // innermost loops first, and so do loads that are safe to execute early
+    // and that no store or call inside the loop can overwrite.
+    class LicmPass final : public Pass
+    {
+    public:
+        std::string name() const override { return "licm"; }
+        void run(IrModule *module) override;
+    };
+
+} // namespace optimize
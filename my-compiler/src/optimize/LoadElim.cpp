@@ -0,0 +1,191 @@
+#include "LoadElim.hpp"
+#include "Dominators.hpp"
+#include "IrUtils.hpp"
+#include "AliasAnalysis.hpp"
+
+#include "../midend/llvm/IrModule.hpp"
+#include "../midend/llvm/value/IrFunction.hpp"
+#include "../midend/llvm/value/IrBasicBlock.hpp"
+#include "../midend/llvm/instr/Instr.hpp"
+#include "../utils/CompileStats.hpp"
+
+#include <climits>
+#include <map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace optimize
+{
+
+    namespace
+    {
+
+        // Same base and constant offset is the same location even through
+        // different GEPs; anything else is keyed by the pointer itself.
+        using Location = std::pair<IrValue *, long long>;
+
+        Location locationOf(IrValue *ptr)
+        {
+            long long offset;
+            if (constantOffset(ptr, offset))
+                return {pointerBase(ptr), offset};
+            return {ptr, LLONG_MIN};
+        }
+
+        struct Known
+        {
+            IrValue *ptr;
+            IrValue *value;
+        };
+
+        // The memory state at some point: what each location holds.
+        using MemoryState = std::map<Location, Known>;
+
+        class Eliminator
+        {
+        public:
+            Eliminator(IrFunction *func, const AliasAnalysis &aa) : func(func), dt(func), aa(aa) {}
+
+            int removed = 0;
+
+            void run()
+            {
+                refreshParentBlocks(func);
+                visit(dt.order().front(), MemoryState());
+            }
+
+        private:
+            IrFunction *func;
+            DominatorTree dt;
+            const AliasAnalysis &aa;
+
+            void clobber(MemoryState &state, IrValue *ptr) const
+            {
+                for (auto it = state.begin(); it != state.end();)
+                {
+                    if (aa.mayAlias(it->second.ptr, ptr))
+                        it = state.erase(it);
+                    else
+                        ++it;
+                }
+            }
+
+            // Locals whose address never escapes survive any call.
+            void clobberByCall(MemoryState &state, Instr *call) const
+            {
+                for (auto it = state.begin(); it != state.end();)
+                {
+                    if (aa.callMayWrite(call, it->second.ptr))
+                        it = state.erase(it);
+                    else
+                        ++it;
+                }
+            }
+
+            // Applies whatever `bb` may write to `state`, without rewriting.
+            void clobberBy(IrBasicBlock *bb, MemoryState &state) const
+            {
+                for (auto *instr : bb->instructions)
+                {
+                    if (instr->instrType == InstrType::STORE)
+                        clobber(state, instr->getOperand(1));
+                    else if (instr->instrType == InstrType::CALL)
+                        clobberByCall(state, instr);
+                }
+            }
+
+            // Blocks on some path from `from` to `to` that avoids `from`
+            // after leaving it; `to` itself is included only if it lies on a
+            // cycle through them.
+            std::vector<IrBasicBlock *> between(IrBasicBlock *from, IrBasicBlock *to) const
+            {
+                std::unordered_set<IrBasicBlock *> seen;
+                std::vector<IrBasicBlock *> work, found;
+                for (auto *p : dt.predecessors(to))
+                {
+                    if (p != from && seen.insert(p).second)
+                        work.push_back(p);
+                }
+                while (!work.empty())
+                {
+                    IrBasicBlock *bb = work.back();
+                    work.pop_back();
+                    found.push_back(bb);
+                    for (auto *p : dt.predecessors(bb))
+                    {
+                        if (p != from && seen.insert(p).second)
+                            work.push_back(p);
+                    }
+                }
+                return found;
+            }
+
+            void visit(IrBasicBlock *bb, MemoryState state)
+            {
+                for (auto it = bb->instructions.begin(); it != bb->instructions.end();)
+                {
+                    Instr *instr = *it;
+                    if (instr->instrType == InstrType::LOAD)
+                    {
+                        IrValue *ptr = instr->getOperand(0);
+                        Location loc = locationOf(ptr);
+                        auto known = state.find(loc);
+                        if (known != state.end() && known->second.value->type == instr->type)
+                        {
+                            instr->replaceAllUsesWith(known->second.value);
+                            detachOperands(instr);
+                            it = bb->instructions.erase(it);
+                            ++removed;
+                            continue;
+                        }
+                        state[loc] = {ptr, instr};
+                    }
+                    else if (instr->instrType == InstrType::STORE)
+                    {
+                        IrValue *ptr = instr->getOperand(1);
+                        clobber(state, ptr);
+                        state[locationOf(ptr)] = {ptr, instr->getOperand(0)};
+                    }
+                    else if (instr->instrType == InstrType::CALL)
+                    {
+                        clobberByCall(state, instr);
+                    }
+                    ++it;
+                }
+
+                for (auto *child : dt.children(bb))
+                {
+                    MemoryState inherited = state;
+                    for (auto *mid : between(bb, child))
+                    {
+                        if (inherited.empty())
+                            break;
+                        clobberBy(mid, inherited);
+                    }
+                    visit(child, std::move(inherited));
+                }
+            }
+        };
+
+    } // namespace
+
+    void LoadElimPass::run(IrModule *module)
+    {
+        if (!module)
+            return;
+
+        AliasAnalysis aa(module);
+        int removed = 0;
+        for (auto *func : module->functions)
+        {
+            if (!func || func->isBuiltin || func->blocks.empty())
+                continue;
+            Eliminator eliminator(func, aa);
+            eliminator.run();
+            removed += eliminator.removed;
+        }
+        CompileStats::Record("loadelim", "loads removed: " + std::to_string(removed));
+    }
+
+} // namespace optimize
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "Pass.hpp"
+
+namespace optimize
+{
+
+    // Redundant load elimination with store-to-load forwarding. Walks the
+    // dominator tree carrying the known contents of memory locations:
+    // a load of a known location becomes the loaded or stored value. A
+    // block inherits its immediate dominator's state minus whatever a store
+    // or call on some path between the two may have overwritten.
+    class LoadElimPass final : public Pass
+    {
+    public:
+        std::string name() const override { return "loadelim"; }
+        void run(IrModule *module) override;
+    };
+
+} // namespace optimize
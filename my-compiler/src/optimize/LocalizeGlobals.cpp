@@ -0,0 +1,199 @@
+#include "LocalizeGlobals.hpp"
+#include "IrUtils.hpp"
+
+#include "../midend/llvm/IrModule.hpp"
+#include "../midend/llvm/value/IrFunction.hpp"
+#include "../midend/llvm/value/IrBasicBlock.hpp"
+#include "../midend/llvm/value/IrConstantInt.hpp"
+#include "../midend/llvm/value/IrGlobalValue.hpp"
+#include "../midend/llvm/type/IrPointerType.hpp"
+#include "../midend/llvm/instr/AllocaInstr.hpp"
+#include "../midend/llvm/instr/StoreInstr.hpp"
+#include "../utils/CompileStats.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace optimize
+{
+
+    namespace
+    {
+
+        bool callsItself(IrFunction *func)
+        {
+            std::unordered_set<IrFunction *> seen;
+            std::vector<IrFunction *> work = {func};
+            while (!work.empty())
+            {
+                IrFunction *f = work.back();
+                work.pop_back();
+                for (auto *bb : f->blocks)
+                {
+                    for (auto *instr : bb->instructions)
+                    {
+                        if (instr->instrType != InstrType::CALL)
+                            continue;
+                        auto *callee = static_cast<IrFunction *>(instr->getOperand(0));
+                        if (callee == func)
+                            return true;
+                        if (seen.insert(callee).second)
+                            work.push_back(callee);
+                    }
+                }
+            }
+            return false;
+        }
+
+        // Must-analysis: is `gv` stored on every path from the entry to
+        // each of its loads?
+        bool storedBeforeLoads(IrFunction *func, IrGlobalValue *gv)
+        {
+            std::unordered_map<IrBasicBlock *, std::vector<IrBasicBlock *>> preds;
+            for (auto *bb : func->blocks)
+            {
+                for (auto *succ : successors(bb))
+                    preds[succ].push_back(bb);
+            }
+            auto storedAtEnd = [&](IrBasicBlock *bb, bool stored)
+            {
+                for (auto *instr : bb->instructions)
+                {
+                    if (instr->instrType == InstrType::STORE && instr->getOperand(1) == gv)
+                        stored = true;
+                }
+                return stored;
+            };
+
+            IrBasicBlock *entry = func->blocks.front();
+            std::unordered_map<IrBasicBlock *, bool> out;
+            for (auto *bb : func->blocks)
+                out[bb] = true;
+            std::unordered_map<IrBasicBlock *, bool> in;
+            bool changed = true;
+            while (changed)
+            {
+                changed = false;
+                for (auto *bb : func->blocks)
+                {
+                    bool stored = bb != entry;
+                    for (auto *p : preds[bb])
+                        stored = stored && out[p];
+                    in[bb] = stored;
+                    bool end = storedAtEnd(bb, stored);
+                    if (end != out[bb])
+                    {
+                        out[bb] = end;
+                        changed = true;
+                    }
+                }
+            }
+
+            for (auto *bb : func->blocks)
+            {
+                bool stored = in[bb];
+                for (auto *instr : bb->instructions)
+                {
+                    if (instr->instrType == InstrType::STORE && instr->getOperand(1) == gv)
+                        stored = true;
+                    else if (instr->instrType == InstrType::LOAD && instr->getOperand(0) == gv && !stored)
+                        return false;
+                }
+            }
+            return true;
+        }
+
+    } // namespace
+
+    void LocalizeGlobalsPass::run(IrModule *module)
+    {
+        if (!module)
+            return;
+
+        std::unordered_map<Instr *, IrFunction *> owner;
+        for (auto *func : module->functions)
+        {
+            refreshParentBlocks(func);
+            for (auto *bb : func->blocks)
+            {
+                for (auto *instr : bb->instructions)
+                    owner[instr] = func;
+            }
+        }
+
+        int folded = 0, localized = 0;
+        std::vector<IrGlobalValue *> kept;
+        for (auto *gv : module->globalValues)
+        {
+            IrType *type = static_cast<IrPointerType *>(gv->type)->pointedType;
+            auto *init = dynamic_cast<IrConstantInt *>(gv->initVal);
+            if (!type->isInt32() || !init)
+            {
+                kept.push_back(gv);
+                continue;
+            }
+
+            bool direct = true, stored = false;
+            std::unordered_set<IrFunction *> users;
+            for (auto *use : gv->useList)
+            {
+                auto *instr = dynamic_cast<Instr *>(use->user);
+                bool isLoad = instr && instr->instrType == InstrType::LOAD && instr->getOperand(0) == gv;
+                bool isStore = instr && instr->instrType == InstrType::STORE && instr->getOperand(1) == gv &&
+                               instr->getOperand(0) != gv;
+                direct = direct && (isLoad || isStore);
+                stored = stored || isStore;
+                if (instr)
+                    users.insert(owner[instr]);
+            }
+            if (!direct || users.count(nullptr))
+            {
+                kept.push_back(gv);
+                continue;
+            }
+
+            if (!stored)
+            {
+                std::vector<Instr *> loads;
+                for (auto *use : gv->useList)
+                    loads.push_back(static_cast<Instr *>(use->user));
+                for (auto *load : loads)
+                {
+                    load->replaceAllUsesWith(IrConstantInt::get(init->value));
+                    detachOperands(load);
+                    load->parentBlock->instructions.remove(load);
+                }
+                ++folded;
+                continue;
+            }
+
+            IrFunction *func = users.size() == 1 ? *users.begin() : nullptr;
+            bool isMain = func && func->name == "@main" && func->useList.empty();
+            if (!func || !(isMain || (!callsItself(func) && storedBeforeLoads(func, gv))))
+            {
+                kept.push_back(gv);
+                continue;
+            }
+
+            IrBasicBlock *entry = func->blocks.front();
+            auto *slot = new AllocaInstr(type, "%" + gv->name.substr(1) + ".local");
+            gv->replaceAllUsesWith(slot);
+            slot->parentBlock = entry;
+            auto pos = entry->instructions.insert(entry->instructions.begin(), slot);
+            if (isMain)
+            {
+                auto *store = new StoreInstr(IrConstantInt::get(init->value), slot);
+                store->parentBlock = entry;
+                entry->instructions.insert(std::next(pos), store);
+            }
+            ++localized;
+        }
+        module->globalValues = kept;
+
+        CompileStats::Record("localize", "globals folded: " + std::to_string(folded) +
+                                             ", globals localized: " + std::to_string(localized));
+    }
+
+} // namespace optimize
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "Pass.hpp"
+
+namespace optimize
+{
+
+    // Scalar globals that are only loaded and stored directly. One that is
+    // never stored reads as its initializer everywhere. One that a single
+    // function touches becomes an entry-block alloca there, for mem2reg to
+    // promote: in main it starts from the initializer; in a non-recursive
+    // function only if every load follows a store in the same call, since
+    // nothing carries the value from one call to the next.
+    class LocalizeGlobalsPass final : public Pass
+    {
+    public:
+        std::string name() const override { return "localize"; }
+        void run(IrModule *module) override;
+    };
+
+} // namespace optimize
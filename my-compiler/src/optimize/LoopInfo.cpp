@@ -0,0 +1,207 @@
+#include "LoopInfo.hpp"
+#include "Dominators.hpp"
+#include "IrUtils.hpp"
+
+#include "../midend/llvm/value/IrFunction.hpp"
+#include "../midend/llvm/value/IrBasicBlock.hpp"
+#include "../midend/llvm/type/IrBaseType.hpp"
+#include "../midend/llvm/instr/JumpInstr.hpp"
+#include "../midend/llvm/instr/PhiInstr.hpp"
+
+#include <algorithm>
+
+namespace optimize
+{
+
+    std::vector<IrBasicBlock *> Loop::exitingBlocks() const
+    {
+        std::vector<IrBasicBlock *> result;
+        for (auto *bb : blocks)
+        {
+            for (auto *s : successors(bb))
+            {
+                if (!contains(s))
+                {
+                    result.push_back(bb);
+                    break;
+                }
+            }
+        }
+        return result;
+    }
+
+    LoopInfo::LoopInfo(IrFunction *func, const DominatorTree &dt)
+    {
+        (void)func;
+        std::unordered_map<IrBasicBlock *, Loop *> byHeader;
+        for (auto *bb : dt.order())
+        {
+            for (auto *h : successors(bb))
+            {
+                if (!dt.dominates(h, bb))
+                    continue;
+                Loop *&loop = byHeader[h];
+                if (!loop)
+                {
+                    storage.push_back(std::make_unique<Loop>());
+                    loop = storage.back().get();
+                    loop->header = h;
+                    loop->blockSet.insert(h);
+                }
+                loop->latches.push_back(bb);
+            }
+        }
+
+        for (auto &loop : storage)
+        {
+            // The header is already in the set, which stops the walk there.
+            std::vector<IrBasicBlock *> work;
+            for (auto *latch : loop->latches)
+            {
+                if (loop->blockSet.insert(latch).second)
+                    work.push_back(latch);
+            }
+            while (!work.empty())
+            {
+                IrBasicBlock *bb = work.back();
+                work.pop_back();
+                for (auto *p : dt.predecessors(bb))
+                {
+                    if (loop->blockSet.insert(p).second)
+                        work.push_back(p);
+                }
+            }
+            for (auto *bb : dt.order())
+            {
+                if (loop->blockSet.count(bb))
+                    loop->blocks.push_back(bb);
+            }
+        }
+
+        // Larger loops first, so each smaller one finds its parent as the
+        // innermost loop seen so far that holds its header.
+        std::vector<Loop *> bySize;
+        for (auto &loop : storage)
+            bySize.push_back(loop.get());
+        std::stable_sort(bySize.begin(), bySize.end(), [](Loop *a, Loop *b)
+                         { return a->blocks.size() > b->blocks.size(); });
+        for (auto *loop : bySize)
+        {
+            auto it = innermost.find(loop->header);
+            if (it != innermost.end())
+            {
+                loop->parent = it->second;
+                loop->depth = loop->parent->depth + 1;
+                loop->parent->subLoops.push_back(loop);
+            }
+            for (auto *bb : loop->blocks)
+                innermost[bb] = loop;
+        }
+
+        std::vector<Loop *> stack;
+        for (auto it = bySize.rbegin(); it != bySize.rend(); ++it)
+        {
+            if (!(*it)->parent)
+                stack.push_back(*it);
+        }
+        while (!stack.empty())
+        {
+            Loop *loop = stack.back();
+            stack.pop_back();
+            order.push_back(loop);
+            for (auto it = loop->subLoops.rbegin(); it != loop->subLoops.rend(); ++it)
+                stack.push_back(*it);
+        }
+
+        for (auto &loop : storage)
+        {
+            IrBasicBlock *outside = nullptr;
+            int count = 0;
+            for (auto *p : dt.predecessors(loop->header))
+            {
+                if (!loop->contains(p))
+                {
+                    outside = p;
+                    ++count;
+                }
+            }
+            if (count == 1 && successors(outside).size() == 1)
+                loop->preheader = outside;
+        }
+    }
+
+    Loop *LoopInfo::loopFor(IrBasicBlock *bb) const
+    {
+        auto it = innermost.find(bb);
+        return it == innermost.end() ? nullptr : it->second;
+    }
+
+    bool ensurePreheaders(IrFunction *func, const LoopInfo &loops, const DominatorTree &dt)
+    {
+        bool changed = false;
+        for (auto *loop : loops.loops())
+        {
+            if (loop->preheader)
+                continue;
+            IrBasicBlock *header = loop->header;
+            std::vector<IrBasicBlock *> outside;
+            for (auto *p : dt.predecessors(header))
+            {
+                if (!loop->contains(p))
+                    outside.push_back(p);
+            }
+            if (outside.empty())
+                continue; // the entry block; nothing can be hoisted above it
+
+            auto *pre = new IrBasicBlock(freshBlockName(func, header->name + "_pre"), func);
+            func->blocks.insert(std::find(func->blocks.begin(), func->blocks.end(), header), pre);
+
+            for (auto *instr : header->instructions)
+            {
+                auto *phi = dynamic_cast<PhiInstr *>(instr);
+                if (!phi)
+                    break;
+                if (outside.size() == 1)
+                {
+                    phi->replaceIncomingBlock(outside.front(), pre);
+                    continue;
+                }
+                auto *merged = new PhiInstr(phi->type, phi->name + ".pre");
+                merged->parentBlock = pre;
+                for (auto *p : outside)
+                    merged->addIncoming(phi->getIncomingValue(p), p);
+                pre->instructions.push_back(merged);
+            }
+            if (outside.size() > 1)
+            {
+                auto merged = pre->instructions.begin();
+                for (auto *p : outside)
+                    removePhiIncoming(header, p);
+                for (auto *instr : header->instructions)
+                {
+                    auto *phi = dynamic_cast<PhiInstr *>(instr);
+                    if (!phi)
+                        break;
+                    phi->addIncoming(*merged++, pre);
+                }
+            }
+
+            auto *jump = new JumpInstr(header);
+            jump->parentBlock = pre;
+            pre->instructions.push_back(jump);
+
+            for (auto *p : outside)
+            {
+                Instr *term = terminator(p);
+                for (size_t i = 0; i < term->operandList.size(); ++i)
+                {
+                    if (term->getOperand((int)i) == header)
+                        term->setOperand((int)i, pre);
+                }
+            }
+            changed = true;
+        }
+        return changed;
+    }
+
+} // namespace optimize
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class IrFunction;
+class IrBasicBlock;
+
+namespace optimize
+{
+
+    class DominatorTree;
+
+    // A natural loop: the header plus every block that reaches a back edge
+    // into it without passing through the header.
+    struct Loop
+    {
+        IrBasicBlock *header = nullptr;
+        IrBasicBlock *preheader = nullptr; // set once ensurePreheaders ran
+        Loop *parent = nullptr;
+        std::vector<Loop *> subLoops;
+        std::vector<IrBasicBlock *> blocks; // in reverse postorder, header first
+        std::unordered_set<IrBasicBlock *> blockSet;
+        std::vector<IrBasicBlock *> latches;
+        int depth = 1;
+
+        bool contains(IrBasicBlock *bb) const { return blockSet.count(bb) != 0; }
+
+        // Blocks inside the loop with a successor outside it.
+        std::vector<IrBasicBlock *> exitingBlocks() const;
+    };
+
+    // The loop nest of one function. Back edges sharing a header form one
+    // loop; loops nest by block containment.
+    class LoopInfo
+    {
+    public:
+        LoopInfo(IrFunction *func, const DominatorTree &dt);
+
+        // Outermost loops first, then their children (preorder).
+        const std::vector<Loop *> &loops() const { return order; }
+
+        // Innermost loop containing `bb`, or nullptr.
+        Loop *loopFor(IrBasicBlock *bb) const;
+
+    private:
+        std::vector<std::unique_ptr<Loop>> storage;
+        std::vector<Loop *> order;
+        std::unordered_map<IrBasicBlock *, Loop *> innermost;
+    };
+
+    // Gives every loop header a single predecessor outside the loop whose
+    // only successor is the header, splitting edges where needed. Returns
+    // whether the CFG changed (dominators and loop info are then stale).
+    bool ensurePreheaders(IrFunction *func, const LoopInfo &loops, const DominatorTree &dt);
+
+} // namespace optimize
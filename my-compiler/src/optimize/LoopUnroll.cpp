@@ -0,0 +1,578 @@
+#include "LoopUnroll.hpp"
+#include "Dominators.hpp"
+#include "InductionVariables.hpp"
+#include "IrUtils.hpp"
+#include "LoopInfo.hpp"
+
+#include "../midend/llvm/IrModule.hpp"
+#include "../midend/llvm/value/IrFunction.hpp"
+#include "../midend/llvm/value/IrBasicBlock.hpp"
+#include "../midend/llvm/value/IrConstantInt.hpp"
+#include "../midend/llvm/type/IrBaseType.hpp"
+#include "../midend/llvm/instr/AluInstr.hpp"
+#include "../midend/llvm/instr/BranchInstr.hpp"
+#include "../midend/llvm/instr/IcmpInstr.hpp"
+#include "../midend/llvm/instr/JumpInstr.hpp"
+#include "../midend/llvm/instr/PhiInstr.hpp"
+#include "../utils/CompileStats.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace optimize
+{
+
+    namespace
+    {
+
+        constexpr int kMaxFullTrips = 32;
+        constexpr int kFullUnrollBudget = 400; // instructions after peeling
+        constexpr int kPartialBudget = 160;    // instructions in the unrolled body
+        constexpr int kMaxFactor = 8;
+
+        using ValueMap = std::unordered_map<IrValue *, IrValue *>;
+
+        IrValue *mapped(const ValueMap &map, IrValue *v)
+        {
+            auto it = map.find(v);
+            return it == map.end() ? v : it->second;
+        }
+
+        bool holds(IcmpCond cond, long long a, long long b)
+        {
+            switch (cond)
+            {
+            case IcmpCond::SLT:
+                return a < b;
+            case IcmpCond::SLE:
+                return a <= b;
+            case IcmpCond::SGT:
+                return a > b;
+            case IcmpCond::SGE:
+                return a >= b;
+            case IcmpCond::EQ:
+                return a == b;
+            case IcmpCond::NE:
+                return a != b;
+            }
+            return false;
+        }
+
+        std::vector<PhiInstr *> phisOf(IrBasicBlock *bb)
+        {
+            std::vector<PhiInstr *> phis;
+            for (auto *instr : bb->instructions)
+            {
+                auto *phi = dynamic_cast<PhiInstr *>(instr);
+                if (!phi)
+                    break;
+                phis.push_back(phi);
+            }
+            return phis;
+        }
+
+        // for (iv = init; iv <cond> bound; iv = iv + step), tested in the
+        // header, which is also the only way out.
+        struct CountedLoop
+        {
+            Loop *loop = nullptr;
+            IrBasicBlock *header = nullptr;
+            IrBasicBlock *preheader = nullptr;
+            IrBasicBlock *latch = nullptr;
+            IrBasicBlock *body = nullptr; // header's successor inside the loop
+            IrBasicBlock *exit = nullptr;
+            PhiInstr *iv = nullptr;
+            IrValue *bound = nullptr;
+            IcmpCond cond = IcmpCond::SLT; // with the induction variable on the left
+            int step = 0;
+            int size = 0;
+        };
+
+        bool analyze(Loop *loop, CountedLoop &cl)
+        {
+            if (!loop->subLoops.empty() || !loop->preheader || loop->latches.size() != 1)
+                return false;
+            cl.loop = loop;
+            cl.header = loop->header;
+            cl.preheader = loop->preheader;
+            cl.latch = loop->latches.front();
+            if (cl.latch == cl.header)
+                return false;
+
+            auto exiting = loop->exitingBlocks();
+            if (exiting.size() != 1 || exiting.front() != cl.header)
+                return false;
+            Instr *latchTerm = terminator(cl.latch);
+            if (!latchTerm || latchTerm->instrType != InstrType::JUMP)
+                return false;
+
+            Instr *br = terminator(cl.header);
+            if (!br || br->instrType != InstrType::BR)
+                return false;
+            cl.body = dynamic_cast<IrBasicBlock *>(br->getOperand(1));
+            cl.exit = dynamic_cast<IrBasicBlock *>(br->getOperand(2));
+            if (!cl.body || !cl.exit || !loop->contains(cl.body) || loop->contains(cl.exit))
+                return false;
+
+            auto *cmp = dynamic_cast<IcmpInstr *>(br->getOperand(0));
+            if (!cmp || cmp->parentBlock != cl.header)
+                return false;
+            auto isIv = [&](IrValue *v)
+            {
+                auto *phi = dynamic_cast<PhiInstr *>(v);
+                return phi && phi->parentBlock == cl.header;
+            };
+            auto isInvariant = [&](IrValue *v)
+            {
+                auto *instr = dynamic_cast<Instr *>(v);
+                return !instr || !loop->contains(instr->parentBlock);
+            };
+            if (isIv(cmp->getOperand(0)) && isInvariant(cmp->getOperand(1)))
+            {
+                cl.iv = static_cast<PhiInstr *>(cmp->getOperand(0));
+                cl.bound = cmp->getOperand(1);
+                cl.cond = cmp->cond;
+            }
+            else if (isIv(cmp->getOperand(1)) && isInvariant(cmp->getOperand(0)))
+            {
+                cl.iv = static_cast<PhiInstr *>(cmp->getOperand(1));
+                cl.bound = cmp->getOperand(0);
+                cl.cond = swappedCond(cmp->cond);
+            }
+            else
+                return false;
+
+            InductionVariable iv;
+            if (!matchInduction(*loop, cl.iv, iv))
+                return false;
+            cl.step = iv.step;
+            bool upward = cl.cond == IcmpCond::SLT || cl.cond == IcmpCond::SLE;
+            bool downward = cl.cond == IcmpCond::SGT || cl.cond == IcmpCond::SGE;
+            if (!((upward && cl.step > 0) || (downward && cl.step < 0)))
+                return false;
+
+            // Body copies are spliced in where the header was; a body phi
+            // naming the header as predecessor would have no counterpart.
+            for (auto *bb : loop->blocks)
+            {
+                if (bb == cl.header)
+                    continue;
+                for (auto *phi : phisOf(bb))
+                {
+                    for (size_t i = 1; i < phi->operandList.size(); i += 2)
+                    {
+                        if (phi->getOperand((int)i) == cl.header)
+                            return false;
+                    }
+                }
+            }
+
+            for (auto *bb : loop->blocks)
+                cl.size += (int)bb->instructions.size();
+            return true;
+        }
+
+        // Exact trip count when start and bound are constants, or -1.
+        int constantTripCount(const CountedLoop &cl)
+        {
+            auto *init = dynamic_cast<IrConstantInt *>(cl.iv->getIncomingValue(cl.preheader));
+            auto *bound = dynamic_cast<IrConstantInt *>(cl.bound);
+            if (!init || !bound)
+                return -1;
+            long long x = init->value;
+            int trips = 0;
+            while (holds(cl.cond, x, bound->value))
+            {
+                if (++trips > kMaxFullTrips)
+                    return -1;
+                x += cl.step;
+                if (x < INT32_MIN || x > INT32_MAX)
+                    return -1;
+            }
+            return trips;
+        }
+
+        // Copies `blocks` under new names; instructions in `skip` are left
+        // out and must already have their images in `map`.
+        std::vector<IrBasicBlock *> cloneBlocks(IrFunction *func, const std::vector<IrBasicBlock *> &blocks,
+                                                const std::string &tag, ValueMap &map,
+                                                const std::unordered_set<Instr *> &skip)
+        {
+            std::vector<IrBasicBlock *> copies;
+            for (auto *bb : blocks)
+            {
+                auto *copy = new IrBasicBlock(bb->name + tag, func);
+                map[bb] = copy;
+                copies.push_back(copy);
+            }
+            std::vector<Instr *> clones;
+            for (size_t i = 0; i < blocks.size(); ++i)
+            {
+                for (auto *instr : blocks[i]->instructions)
+                {
+                    if (skip.count(instr))
+                        continue;
+                    Instr *clone = cloneInstr(instr, instr->name.empty() ? "" : instr->name + tag);
+                    clone->parentBlock = copies[i];
+                    copies[i]->instructions.push_back(clone);
+                    map[instr] = clone;
+                    clones.push_back(clone);
+                }
+            }
+            for (auto *clone : clones)
+                remapOperands(clone, map);
+            return copies;
+        }
+
+        void insertBefore(IrFunction *func, IrBasicBlock *pos, const std::vector<IrBasicBlock *> &blocks)
+        {
+            auto at = std::find(func->blocks.begin(), func->blocks.end(), pos);
+            func->blocks.insert(at, blocks.begin(), blocks.end());
+        }
+
+        void retarget(Instr *term, IrBasicBlock *from, IrBasicBlock *to)
+        {
+            for (size_t i = 0; i < term->operandList.size(); ++i)
+            {
+                if (term->getOperand((int)i) == from)
+                    term->setOperand((int)i, to);
+            }
+        }
+
+        // Makes `phi` take `value` from `to` where it used to come from `from`.
+        void replaceIncoming(PhiInstr *phi, IrBasicBlock *from, IrBasicBlock *to, IrValue *value)
+        {
+            for (size_t i = 0; i + 1 < phi->operandList.size(); i += 2)
+            {
+                if (phi->getOperand((int)i + 1) == from)
+                {
+                    phi->setOperand((int)i, value);
+                    phi->setOperand((int)i + 1, to);
+                }
+            }
+        }
+
+        // Peels all `trips` iterations in front of the loop. Every copy keeps
+        // its exit test, so this is exact whatever the count; with constant
+        // bounds SCCP folds the tests and finds the loop itself dead.
+        void unrollFully(IrFunction *func, const CountedLoop &cl, int trips, int id)
+        {
+            IrBasicBlock *H = cl.header;
+            std::vector<PhiInstr *> phis = phisOf(H);
+            std::unordered_set<Instr *> skip(phis.begin(), phis.end());
+
+            std::vector<ValueMap> maps(trips);
+            std::vector<IrBasicBlock *> headers, latches;
+            std::unordered_set<IrBasicBlock *> copied;
+            for (int k = 0; k < trips; ++k)
+            {
+                ValueMap &map = maps[k];
+                for (auto *phi : phis)
+                {
+                    map[phi] = k == 0 ? phi->getIncomingValue(cl.preheader)
+                                      : mapped(maps[k - 1], phi->getIncomingValue(cl.latch));
+                }
+                auto copies = cloneBlocks(func, cl.loop->blocks, "_u" + std::to_string(id) + "_" + std::to_string(k), map, skip);
+                insertBefore(func, H, copies);
+                copied.insert(copies.begin(), copies.end());
+                headers.push_back(static_cast<IrBasicBlock *>(map[H]));
+                latches.push_back(static_cast<IrBasicBlock *>(map[cl.latch]));
+            }
+
+            for (int k = 0; k < trips; ++k)
+                retarget(terminator(latches[k]), headers[k], k + 1 < trips ? headers[k + 1] : H);
+            retarget(terminator(cl.preheader), H, headers.front());
+
+            std::vector<IrValue *> entering;
+            for (auto *phi : phis)
+                entering.push_back(mapped(maps.back(), phi->getIncomingValue(cl.latch)));
+            for (size_t i = 0; i < phis.size(); ++i)
+                replaceIncoming(phis[i], cl.preheader, latches.back(), entering[i]);
+
+            // The exit is now also reached from every copied header.
+            for (auto *phi : phisOf(cl.exit))
+            {
+                IrValue *v = phi->getIncomingValue(H);
+                for (int k = 0; k < trips; ++k)
+                    phi->addIncoming(mapped(maps[k], v), headers[k]);
+            }
+
+            // Header values used past the loop need a phi in the exit block,
+            // which the analysis made sure only the header enters.
+            for (auto *instr : std::vector<Instr *>(H->instructions.begin(), H->instructions.end()))
+            {
+                if (instr->type->isVoid())
+                    continue;
+                std::vector<Instr *> outside;
+                for (auto *use : instr->useList)
+                {
+                    auto *user = dynamic_cast<Instr *>(use->user);
+                    if (!user || cl.loop->contains(user->parentBlock) || copied.count(user->parentBlock))
+                        continue;
+                    if (user->parentBlock == cl.exit && user->instrType == InstrType::PHI)
+                        continue;
+                    if (std::find(outside.begin(), outside.end(), user) == outside.end())
+                        outside.push_back(user);
+                }
+                if (outside.empty())
+                    continue;
+                auto *merge = new PhiInstr(instr->type, instr->name + ".lcssa" + std::to_string(id));
+                merge->parentBlock = cl.exit;
+                merge->addIncoming(instr, H);
+                for (int k = 0; k < trips; ++k)
+                    merge->addIncoming(mapped(maps[k], instr), headers[k]);
+                cl.exit->instructions.push_front(merge);
+                for (auto *user : outside)
+                {
+                    for (size_t i = 0; i < user->operandList.size(); ++i)
+                    {
+                        if (user->getOperand((int)i) == instr)
+                            user->setOperand((int)i, merge);
+                    }
+                }
+            }
+        }
+
+        // How far the last iteration of a group runs ahead of the first.
+        long long groupReach(const CountedLoop &cl, int factor)
+        {
+            return (long long)(factor - 1) * cl.step;
+        }
+
+        // The group test compares the induction variable against
+        // bound - reach; reach, the group's stride and with a constant
+        // bound the limit too have to fit in 32 bits.
+        bool groupLimitFits(const CountedLoop &cl, int factor)
+        {
+            long long reach = groupReach(cl, factor);
+            long long stride = (long long)factor * cl.step;
+            if (reach < INT32_MIN || reach > INT32_MAX || stride < INT32_MIN || stride > INT32_MAX)
+                return false;
+            auto *bound = dynamic_cast<IrConstantInt *>(cl.bound);
+            if (!bound)
+                return true;
+            long long limit = bound->value - reach;
+            return limit >= INT32_MIN && limit <= INT32_MAX;
+        }
+
+        // An unrolled loop runs `factor` iterations per trip while the last
+        // of them still passes the test; the original loop then finishes.
+        // The test is iv <cond> bound - reach rather than iv + reach <cond>
+        // bound, which could wrap where the original loop does not. A
+        // variable bound gets a guard block that sends the loop straight to
+        // the original when the subtraction itself would wrap. Copy j
+        // reads the induction variable as the group phi plus j * step, and
+        // the group advances it with a single addition.
+        // Returns the unrolled loop's header.
+        IrBasicBlock *unrollPartially(IrFunction *func, const CountedLoop &cl, int factor, int id)
+        {
+            IrBasicBlock *H = cl.header;
+            const std::string tag = "_p" + std::to_string(id);
+            std::vector<PhiInstr *> phis = phisOf(H);
+            long long reach = groupReach(cl, factor);
+
+            auto *head = new IrBasicBlock(H->name + tag, func);
+            IrBasicBlock *guard = nullptr;
+            IrValue *limit;
+            if (auto *bound = dynamic_cast<IrConstantInt *>(cl.bound))
+            {
+                limit = IrConstantInt::get((int)(bound->value - reach));
+            }
+            else
+            {
+                guard = new IrBasicBlock(H->name + tag + "_guard", func);
+                auto *sub = new AluInstr(InstrType::SUB, cl.bound, IrConstantInt::get((int)reach),
+                                         cl.iv->name + tag + ".limit");
+                auto *safe = reach > 0 ? new IcmpInstr(IcmpCond::SGE, cl.bound, IrConstantInt::get((int)(INT32_MIN + reach)),
+                                                       cl.iv->name + tag + ".safe")
+                                       : new IcmpInstr(IcmpCond::SLE, cl.bound, IrConstantInt::get((int)(INT32_MAX + reach)),
+                                                       cl.iv->name + tag + ".safe");
+                auto *check = new BranchInstr(safe, head, H);
+                for (Instr *instr : std::vector<Instr *>{sub, safe, check})
+                {
+                    instr->parentBlock = guard;
+                    guard->instructions.push_back(instr);
+                }
+                limit = sub;
+            }
+            IrBasicBlock *entry = guard ? guard : cl.preheader;
+
+            std::vector<PhiInstr *> groupPhis;
+            ValueMap values;
+            for (auto *phi : phis)
+            {
+                auto *p = new PhiInstr(phi->type, phi->name + tag);
+                p->parentBlock = head;
+                p->addIncoming(phi->getIncomingValue(cl.preheader), entry);
+                head->instructions.push_back(p);
+                groupPhis.push_back(p);
+                values[phi] = p;
+            }
+            IrValue *groupIv = values[cl.iv];
+            auto *test = new IcmpInstr(cl.cond, groupIv, limit, cl.iv->name + tag + ".test");
+            std::vector<IrBasicBlock *> heads;
+            for (int j = 0; j < factor; ++j)
+                heads.push_back(new IrBasicBlock(H->name + tag + "_" + std::to_string(j), func));
+            auto *br = new BranchInstr(test, heads.front(), H);
+            for (Instr *instr : std::vector<Instr *>{test, br})
+            {
+                instr->parentBlock = head;
+                head->instructions.push_back(instr);
+            }
+
+            std::vector<IrBasicBlock *> bodyBlocks;
+            for (auto *bb : cl.loop->blocks)
+            {
+                if (bb != H)
+                    bodyBlocks.push_back(bb);
+            }
+
+            std::vector<IrBasicBlock *> created;
+            if (guard)
+                created.push_back(guard);
+            created.push_back(head);
+            IrBasicBlock *lastLatch = nullptr;
+            for (int j = 0; j < factor; ++j)
+            {
+                const std::string itag = tag + "_" + std::to_string(j);
+                IrBasicBlock *hd = heads[j];
+                if (j > 0)
+                {
+                    // Copy j counts from the group phi rather than from the
+                    // previous copy's increment.
+                    auto *offset = new AluInstr(InstrType::ADD, groupIv, IrConstantInt::get(j * cl.step),
+                                                cl.iv->name + itag);
+                    offset->parentBlock = hd;
+                    hd->instructions.push_back(offset);
+                    values[cl.iv] = offset;
+                }
+                ValueMap map = values;
+                std::vector<Instr *> clones;
+                for (auto *instr : H->instructions)
+                {
+                    if (instr->instrType == InstrType::PHI || instr == terminator(H))
+                        continue;
+                    Instr *clone = cloneInstr(instr, instr->name.empty() ? "" : instr->name + itag);
+                    clone->parentBlock = hd;
+                    hd->instructions.push_back(clone);
+                    map[instr] = clone;
+                    clones.push_back(clone);
+                }
+                for (auto *clone : clones)
+                    remapOperands(clone, map);
+
+                map[H] = j + 1 < factor ? heads[j + 1] : head;
+                auto copies = cloneBlocks(func, bodyBlocks, itag, map, {});
+                auto *enter = new JumpInstr(static_cast<IrBasicBlock *>(map[cl.body]));
+                enter->parentBlock = hd;
+                hd->instructions.push_back(enter);
+
+                created.push_back(hd);
+                created.insert(created.end(), copies.begin(), copies.end());
+                lastLatch = static_cast<IrBasicBlock *>(map[cl.latch]);
+
+                ValueMap next;
+                for (auto *phi : phis)
+                    next[phi] = mapped(map, phi->getIncomingValue(cl.latch));
+                values = next;
+            }
+
+            // One increment per group instead of one per copy.
+            auto *advance = new AluInstr(InstrType::ADD, groupIv, IrConstantInt::get(factor * cl.step),
+                                         cl.iv->name + tag + ".next");
+            auto &latchInstrs = lastLatch->instructions;
+            latchInstrs.insert(std::find(latchInstrs.begin(), latchInstrs.end(), terminator(lastLatch)), advance);
+            advance->parentBlock = lastLatch;
+            values[cl.iv] = advance;
+            for (size_t i = 0; i < phis.size(); ++i)
+                groupPhis[i]->addIncoming(values[phis[i]], lastLatch);
+            for (size_t i = 0; i < phis.size(); ++i)
+            {
+                IrValue *init = phis[i]->getIncomingValue(cl.preheader);
+                replaceIncoming(phis[i], cl.preheader, head, groupPhis[i]);
+                if (guard)
+                    phis[i]->addIncoming(init, guard);
+            }
+            retarget(terminator(cl.preheader), H, guard ? guard : head);
+            insertBefore(func, H, created);
+            return head;
+        }
+
+        int factorFor(int size)
+        {
+            for (int factor = kMaxFactor; factor >= 2; factor /= 2)
+            {
+                if (factor * size <= kPartialBudget)
+                    return factor;
+            }
+            return 1;
+        }
+
+    } // namespace
+
+    void LoopUnrollPass::run(IrModule *module)
+    {
+        if (!module)
+            return;
+
+        int full = 0, partial = 0;
+        for (auto *func : module->functions)
+        {
+            if (!func || func->isBuiltin || func->blocks.empty())
+                continue;
+
+            // One loop per round: each transformation invalidates the
+            // dominator tree and loop nest.
+            std::unordered_set<IrBasicBlock *> done;
+            for (int round = 0; round < 64; ++round)
+            {
+                refreshParentBlocks(func);
+                auto dt = std::make_unique<DominatorTree>(func);
+                auto loops = std::make_unique<LoopInfo>(func, *dt);
+                if (ensurePreheaders(func, *loops, *dt))
+                {
+                    dt = std::make_unique<DominatorTree>(func);
+                    loops = std::make_unique<LoopInfo>(func, *dt);
+                }
+
+                bool changed = false;
+                for (auto *loop : loops->loops())
+                {
+                    if (!done.insert(loop->header).second)
+                        continue;
+                    CountedLoop cl;
+                    if (!analyze(loop, cl))
+                        continue;
+
+                    int trips = constantTripCount(cl);
+                    if (trips > 0 && trips * cl.size <= kFullUnrollBudget &&
+                        dt->predecessors(cl.exit).size() == 1)
+                    {
+                        unrollFully(func, cl, trips, full + partial);
+                        ++full;
+                        changed = true;
+                        break;
+                    }
+                    if (trips >= 0 && trips < kMaxFactor)
+                        continue;
+                    int factor = factorFor(cl.size);
+                    if (factor < 2 || !groupLimitFits(cl, factor))
+                        continue;
+                    // The unrolled loop is itself counted; leave it be.
+                    done.insert(unrollPartially(func, cl, factor, full + partial));
+                    ++partial;
+                    changed = true;
+                    break;
+                }
+                if (!changed)
+                    break;
+            }
+        }
+        CompileStats::Record("unroll", "fully: " + std::to_string(full) + ", partially: " + std::to_string(partial));
+    }
+
+} // namespace optimize
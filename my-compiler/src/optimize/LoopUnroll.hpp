@@ -0,0 +1,21 @@
+#pragma once
+
+#include "Pass.hpp"
+
+namespace optimize
+{
+
+    // Unrolls innermost counted loops: header-tested loops whose induction
+    // variable steps by a constant towards an invariant bound. Loops with a
+    // small constant trip count are peeled completely (SCCP then removes
+    // the exit tests and the emptied loop); others get an unrolled copy in
+    // front of them that runs while a whole group of iterations fits, with
+    // the original loop left to finish the remainder.
+    class LoopUnrollPass final : public Pass
+    {
+    public:
+        std::string name() const override { return "unroll"; }
+        void run(IrModule *module) override;
+    };
+
+} // namespace optimize
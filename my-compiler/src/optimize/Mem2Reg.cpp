@@ -145,7 +145,8 @@ namespace optimize
         // Some IR builders leave redundant instructions after a terminator (e.g.,
         // break/continue lowering emitting multiple jumps). These instructions are
         // unreachable and will confuse CFG/dominator-based passes if we treat the
-        // last instruction as the terminator.
+        // last instruction as the terminator. SimplifyCfgPass normally runs
+        // first and has done this already.
         static void truncateAfterFirstTerminator(IrFunction *func)
         {
             if (!func)
@@ -498,7 +499,7 @@ namespace optimize
                         if (hasPhi.count(y))
                             continue;
                         auto *pty = dynamic_cast<IrPointerType *>(a->type);
-                        auto *phi = new PhiInstr(pty->pointedType, "%phi" + std::to_string(phiCounter++));
+                        auto *phi = new PhiInstr(pty->pointedType, phiPrefix + std::to_string(phiCounter++));
                         insertPhiAtBlockStart(y, phi);
                         phiFor[a][y] = phi;
                         hasPhi.insert(y);
@@ -2,14 +2,23 @@
 
 #include "Pass.hpp"
 
+#include <string>
+#include <utility>
+
 namespace optimize
 {
 
     class Mem2RegPass final : public Pass
     {
     public:
+        // Phis are named phiPrefix + N; a second run needs its own prefix.
+        explicit Mem2RegPass(std::string phiPrefix = "%phi") : phiPrefix(std::move(phiPrefix)) {}
+
         std::string name() const override { return "mem2reg"; }
         void run(IrModule *module) override;
+
+    private:
+        std::string phiPrefix;
     };
 
 } // namespace optimize
@@ -0,0 +1,402 @@
+#include "Sccp.hpp"
+#include "IrUtils.hpp"
+
+#include "../midend/llvm/IrModule.hpp"
+#include "../midend/llvm/value/IrFunction.hpp"
+#include "../midend/llvm/value/IrBasicBlock.hpp"
+#include "../midend/llvm/value/IrConstantInt.hpp"
+#include "../midend/llvm/instr/IcmpInstr.hpp"
+#include "../midend/llvm/instr/JumpInstr.hpp"
+#include "../utils/CompileStats.hpp"
+
+#include <cstdint>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace optimize
+{
+
+    namespace
+    {
+
+        struct Lattice
+        {
+            enum Kind
+            {
+                Top,   // no evidence yet
+                Const, // always `value`
+                Bottom // varies
+            } kind = Top;
+            int value = 0;
+
+            static Lattice constant(int v) { return {Const, v}; }
+            static Lattice bottom() { return {Bottom, 0}; }
+
+            bool operator==(const Lattice &o) const { return kind == o.kind && (kind != Const || value == o.value); }
+            bool operator!=(const Lattice &o) const { return !(*this == o); }
+        };
+
+        Lattice meet(const Lattice &a, const Lattice &b)
+        {
+            if (a.kind == Lattice::Top)
+                return b;
+            if (b.kind == Lattice::Top)
+                return a;
+            if (a.kind == Lattice::Const && b.kind == Lattice::Const && a.value == b.value)
+                return a;
+            return Lattice::bottom();
+        }
+
+        // Truncates `v` to the width of an integer type, as the backend sees it.
+        int fitToType(IrType *type, int v)
+        {
+            if (type->isInt1())
+                return v & 1;
+            if (type->isInt8())
+                return v & 0xff;
+            return v;
+        }
+
+        bool foldBinary(InstrType op, int a, int b, int &result)
+        {
+            uint32_t ua = (uint32_t)a, ub = (uint32_t)b;
+            switch (op)
+            {
+            case InstrType::ADD:
+                result = (int)(ua + ub);
+                return true;
+            case InstrType::SUB:
+                result = (int)(ua - ub);
+                return true;
+            case InstrType::MUL:
+                result = (int)(ua * ub);
+                return true;
+            case InstrType::SDIV:
+                if (b == 0)
+                    return false;
+                result = (int)((int64_t)a / b);
+                return true;
+            case InstrType::SREM:
+                if (b == 0)
+                    return false;
+                result = (int)((int64_t)a % b);
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        bool foldCompare(IcmpCond cond, int a, int b)
+        {
+            switch (cond)
+            {
+            case IcmpCond::EQ:
+                return a == b;
+            case IcmpCond::NE:
+                return a != b;
+            case IcmpCond::SGT:
+                return a > b;
+            case IcmpCond::SGE:
+                return a >= b;
+            case IcmpCond::SLT:
+                return a < b;
+            case IcmpCond::SLE:
+                return a <= b;
+            }
+            return false;
+        }
+
+        class Solver
+        {
+        public:
+            std::unordered_map<IrValue *, Lattice> values;
+            std::unordered_set<IrBasicBlock *> executable;
+            std::set<std::pair<IrBasicBlock *, IrBasicBlock *>> executableEdges;
+
+            void solve(IrFunction *func)
+            {
+                refreshParentBlocks(func);
+                markEdge(nullptr, func->blocks.front());
+                while (!blockWork.empty() || !instrWork.empty())
+                {
+                    while (!instrWork.empty())
+                    {
+                        Instr *instr = instrWork.back();
+                        instrWork.pop_back();
+                        if (executable.count(instr->parentBlock))
+                            visit(instr);
+                    }
+                    if (!blockWork.empty())
+                    {
+                        IrBasicBlock *bb = blockWork.back();
+                        blockWork.pop_back();
+                        for (auto *instr : bb->instructions)
+                            visit(instr);
+                    }
+                }
+            }
+
+            Lattice get(IrValue *v) const
+            {
+                if (auto *c = dynamic_cast<IrConstantInt *>(v))
+                    return Lattice::constant(c->value);
+                if (!dynamic_cast<Instr *>(v))
+                    return Lattice::bottom(); // parameters, globals
+                auto it = values.find(v);
+                return it == values.end() ? Lattice() : it->second;
+            }
+
+        private:
+            std::vector<IrBasicBlock *> blockWork;
+            std::vector<Instr *> instrWork;
+
+            void markEdge(IrBasicBlock *from, IrBasicBlock *to)
+            {
+                if (!executableEdges.insert({from, to}).second)
+                    return;
+                if (executable.insert(to).second)
+                {
+                    blockWork.push_back(to);
+                    return;
+                }
+                // A new way into a block already seen only changes its phis.
+                for (auto *instr : to->instructions)
+                {
+                    if (instr->instrType != InstrType::PHI)
+                        break;
+                    visit(instr);
+                }
+            }
+
+            void update(Instr *instr, Lattice next)
+            {
+                Lattice old = get(instr);
+                next = meet(old, next);
+                if (next == old)
+                    return;
+                values[instr] = next;
+                for (auto *use : instr->useList)
+                {
+                    if (auto *user = dynamic_cast<Instr *>(use->user))
+                        instrWork.push_back(user);
+                }
+            }
+
+            void visit(Instr *instr)
+            {
+                switch (instr->instrType)
+                {
+                case InstrType::ADD:
+                case InstrType::SUB:
+                case InstrType::MUL:
+                case InstrType::SDIV:
+                case InstrType::SREM:
+                {
+                    Lattice a = get(instr->getOperand(0));
+                    Lattice b = get(instr->getOperand(1));
+                    if (instr->instrType == InstrType::MUL &&
+                        ((a.kind == Lattice::Const && a.value == 0) || (b.kind == Lattice::Const && b.value == 0)))
+                        update(instr, Lattice::constant(0));
+                    else if (a.kind == Lattice::Bottom || b.kind == Lattice::Bottom)
+                        update(instr, Lattice::bottom());
+                    else if (a.kind == Lattice::Const && b.kind == Lattice::Const)
+                    {
+                        int result;
+                        if (foldBinary(instr->instrType, a.value, b.value, result))
+                            update(instr, Lattice::constant(result));
+                        else
+                            update(instr, Lattice::bottom());
+                    }
+                    break;
+                }
+                case InstrType::ICMP:
+                {
+                    Lattice a = get(instr->getOperand(0));
+                    Lattice b = get(instr->getOperand(1));
+                    if (a.kind == Lattice::Bottom || b.kind == Lattice::Bottom)
+                        update(instr, Lattice::bottom());
+                    else if (a.kind == Lattice::Const && b.kind == Lattice::Const)
+                        update(instr, Lattice::constant(foldCompare(static_cast<IcmpInstr *>(instr)->cond, a.value, b.value)));
+                    break;
+                }
+                case InstrType::ZEXT:
+                case InstrType::TRUNC:
+                {
+                    IrValue *src = instr->getOperand(0);
+                    Lattice a = get(src);
+                    if (a.kind == Lattice::Const)
+                    {
+                        IrType *width = instr->instrType == InstrType::ZEXT ? src->type : instr->type;
+                        update(instr, Lattice::constant(fitToType(width, a.value)));
+                    }
+                    else if (a.kind == Lattice::Bottom)
+                        update(instr, Lattice::bottom());
+                    break;
+                }
+                case InstrType::PHI:
+                {
+                    Lattice result;
+                    for (size_t i = 0; i + 1 < instr->operandList.size(); i += 2)
+                    {
+                        auto *from = dynamic_cast<IrBasicBlock *>(instr->getOperand((int)i + 1));
+                        if (executableEdges.count({from, instr->parentBlock}))
+                            result = meet(result, get(instr->getOperand((int)i)));
+                    }
+                    if (result.kind != Lattice::Top)
+                        update(instr, result);
+                    break;
+                }
+                case InstrType::BR:
+                {
+                    Lattice c = get(instr->getOperand(0));
+                    auto *t = dynamic_cast<IrBasicBlock *>(instr->getOperand(1));
+                    auto *f = dynamic_cast<IrBasicBlock *>(instr->getOperand(2));
+                    if (c.kind == Lattice::Const)
+                        markEdge(instr->parentBlock, c.value ? t : f);
+                    else if (c.kind == Lattice::Bottom)
+                    {
+                        markEdge(instr->parentBlock, t);
+                        markEdge(instr->parentBlock, f);
+                    }
+                    break;
+                }
+                case InstrType::JUMP:
+                    markEdge(instr->parentBlock, dynamic_cast<IrBasicBlock *>(instr->getOperand(0)));
+                    break;
+                case InstrType::RET:
+                case InstrType::STORE:
+                    break;
+                default:
+                    // Loads, calls, GEPs, allocas.
+                    if (!instr->type->isVoid())
+                        update(instr, Lattice::bottom());
+                    break;
+                }
+            }
+        };
+
+        struct Counts
+        {
+            int constants = 0;
+            int branches = 0;
+            int blocks = 0;
+        };
+
+        void eraseInstr(Instr *instr)
+        {
+            detachOperands(instr);
+            instr->parentBlock->instructions.remove(instr);
+        }
+
+        void rewrite(IrFunction *func, const Solver &solver, Counts &counts)
+        {
+            // Constants replace the instructions computing them.
+            for (auto *bb : func->blocks)
+            {
+                if (!solver.executable.count(bb))
+                    continue;
+                std::vector<Instr *> folded;
+                for (auto *instr : bb->instructions)
+                {
+                    Lattice l = solver.get(instr);
+                    if (l.kind == Lattice::Const && instr->instrType != InstrType::CALL &&
+                        instr->instrType != InstrType::LOAD)
+                        folded.push_back(instr);
+                }
+                for (auto *instr : folded)
+                {
+                    instr->replaceAllUsesWith(new IrConstantInt(instr->type, fitToType(instr->type, solver.get(instr).value)));
+                    eraseInstr(instr);
+                    ++counts.constants;
+                }
+            }
+
+            // Branches with a single executable edge become jumps.
+            for (auto *bb : func->blocks)
+            {
+                if (!solver.executable.count(bb))
+                    continue;
+                Instr *term = terminator(bb);
+                if (!term || term->instrType != InstrType::BR)
+                    continue;
+                auto *t = dynamic_cast<IrBasicBlock *>(term->getOperand(1));
+                auto *f = dynamic_cast<IrBasicBlock *>(term->getOperand(2));
+                bool toT = solver.executableEdges.count({bb, t}) != 0;
+                bool toF = solver.executableEdges.count({bb, f}) != 0;
+                if (toT == toF)
+                    continue;
+                IrBasicBlock *taken = toT ? t : f;
+                IrBasicBlock *dropped = toT ? f : t;
+                eraseInstr(term);
+                auto *jump = new JumpInstr(taken);
+                jump->parentBlock = bb;
+                bb->instructions.push_back(jump);
+                if (dropped != taken)
+                    removePhiIncoming(dropped, bb);
+                ++counts.branches;
+            }
+
+            // Unreachable blocks go, along with their phi incomings elsewhere.
+            std::vector<IrBasicBlock *> dead;
+            for (auto *bb : func->blocks)
+            {
+                if (!solver.executable.count(bb))
+                    dead.push_back(bb);
+            }
+            for (auto *bb : dead)
+            {
+                for (auto *succ : successors(bb))
+                    removePhiIncoming(succ, bb);
+            }
+            for (auto *bb : dead)
+            {
+                for (auto *instr : bb->instructions)
+                    detachOperands(instr);
+                bb->instructions.clear();
+                func->blocks.remove(bb);
+                ++counts.blocks;
+            }
+
+            // Phis left with one incoming value are just that value.
+            for (auto *bb : func->blocks)
+            {
+                std::vector<Instr *> trivial;
+                for (auto *instr : bb->instructions)
+                {
+                    if (instr->instrType != InstrType::PHI)
+                        break;
+                    if (instr->operandList.size() == 2)
+                        trivial.push_back(instr);
+                }
+                for (auto *phi : trivial)
+                {
+                    phi->replaceAllUsesWith(phi->getOperand(0));
+                    eraseInstr(phi);
+                }
+            }
+        }
+
+    } // namespace
+
+    void SccpPass::run(IrModule *module)
+    {
+        if (!module)
+            return;
+
+        Counts counts;
+        for (auto *func : module->functions)
+        {
+            if (!func || func->isBuiltin || func->blocks.empty())
+                continue;
+            Solver solver;
+            solver.solve(func);
+            rewrite(func, solver, counts);
+        }
+        CompileStats::Record("sccp", "constants: " + std::to_string(counts.constants) +
+                                         ", branches: " + std::to_string(counts.branches) +
+                                         ", blocks removed: " + std::to_string(counts.blocks));
+    }
+
+} // namespace optimize
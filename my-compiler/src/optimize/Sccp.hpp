@@ -0,0 +1,18 @@
+#pragma once
+
+#include "Pass.hpp"
+
+namespace optimize
+{
+
+    // Sparse conditional constant propagation (Wegman-Zadeck) on the SSA form
+    // left by mem2reg. Values found constant are replaced, branches on
+    // constants become jumps and blocks never reached are deleted.
+    class SccpPass final : public Pass
+    {
+    public:
+        std::string name() const override { return "sccp"; }
+        void run(IrModule *module) override;
+    };
+
+} // namespace optimize
@@ -0,0 +1,85 @@
+#include "SideEffects.hpp"
+#include "AliasAnalysis.hpp"
+
+#include "../midend/llvm/IrModule.hpp"
+#include "../midend/llvm/value/IrFunction.hpp"
+#include "../midend/llvm/value/IrBasicBlock.hpp"
+#include "../midend/llvm/instr/Instr.hpp"
+#include "../midend/llvm/instr/AllocaInstr.hpp"
+
+namespace optimize
+{
+
+    namespace
+    {
+
+        // Stores outside the function's own frame, ignoring callees.
+        bool writesNonLocalMemory(IrFunction *func)
+        {
+            for (auto *bb : func->blocks)
+            {
+                for (auto *instr : bb->instructions)
+                {
+                    if (instr->instrType != InstrType::STORE)
+                        continue;
+                    if (!dynamic_cast<AllocaInstr *>(pointerBase(instr->getOperand(1))))
+                        return true;
+                }
+            }
+            return false;
+        }
+
+        // Optimistic fixpoint: start from the functions in `set` and spread
+        // to their callers, so recursion stays clean unless something in the
+        // cycle really has the property.
+        void spreadToCallers(IrModule *module, std::unordered_set<IrFunction *> &set)
+        {
+            bool changed = true;
+            while (changed)
+            {
+                changed = false;
+                for (auto *func : module->functions)
+                {
+                    if (set.count(func))
+                        continue;
+                    bool calls = false;
+                    for (auto *bb : func->blocks)
+                    {
+                        for (auto *instr : bb->instructions)
+                        {
+                            if (instr->instrType == InstrType::CALL &&
+                                set.count(dynamic_cast<IrFunction *>(instr->getOperand(0))))
+                            {
+                                calls = true;
+                                break;
+                            }
+                        }
+                        if (calls)
+                            break;
+                    }
+                    if (calls)
+                    {
+                        set.insert(func);
+                        changed = true;
+                    }
+                }
+            }
+        }
+
+    } // namespace
+
+    SideEffectInfo::SideEffectInfo(IrModule *module)
+    {
+        for (auto *func : module->functions)
+        {
+            bool writes = func->isBuiltin ? func->name == "@getarray" : writesNonLocalMemory(func);
+            if (writes)
+                writers.insert(func);
+            if (writes || func->isBuiltin)
+                impure.insert(func);
+        }
+        spreadToCallers(module, impure);
+        spreadToCallers(module, writers);
+    }
+
+} // namespace optimize
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <unordered_set>
+
+class IrModule;
+class IrFunction;
+
+namespace optimize
+{
+
+    // Functions whose calls must be kept even when the result is unused:
+    // they do I/O (every builtin), store to memory that outlives the call,
+    // or call such a function. Everything else may be removed or reordered.
+    // writesMemory is the narrower question asked when moving loads: I/O
+    // builtins other than getarray leave program memory alone.
+    class SideEffectInfo
+    {
+    public:
+        explicit SideEffectInfo(IrModule *module);
+
+        bool hasSideEffects(IrFunction *func) const { return impure.count(func) != 0; }
+        bool writesMemory(IrFunction *func) const { return writers.count(func) != 0; }
+
+    private:
+        std::unordered_set<IrFunction *> impure;
+        std::unordered_set<IrFunction *> writers;
+    };
+
+} // namespace optimize
@@ -0,0 +1,293 @@
+#include "SimplifyCfg.hpp"
+#include "IrUtils.hpp"
+
+#include "../midend/llvm/IrModule.hpp"
+#include "../midend/llvm/value/IrFunction.hpp"
+#include "../midend/llvm/value/IrBasicBlock.hpp"
+#include "../midend/llvm/type/IrBaseType.hpp"
+#include "../midend/llvm/instr/JumpInstr.hpp"
+#include "../midend/llvm/instr/PhiInstr.hpp"
+#include "../utils/CompileStats.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace optimize
+{
+
+    namespace
+    {
+
+        struct Counts
+        {
+            int blocksRemoved = 0;
+            int blocksMerged = 0;
+            int branchesFolded = 0;
+        };
+
+        using PredMap = std::unordered_map<IrBasicBlock *, std::vector<IrBasicBlock *>>;
+
+        PredMap predecessors(IrFunction *func)
+        {
+            PredMap preds;
+            for (auto *bb : func->blocks)
+            {
+                preds[bb];
+                for (auto *succ : successors(bb))
+                    preds[succ].push_back(bb);
+            }
+            return preds;
+        }
+
+        bool hasPhis(IrBasicBlock *bb)
+        {
+            return !bb->instructions.empty() && bb->instructions.front()->instrType == InstrType::PHI;
+        }
+
+        // Drops the blocks in `dead` from the function in one pass over the
+        // block list; their instructions must already be gone.
+        void removeBlocks(IrFunction *func, const std::unordered_set<IrBasicBlock *> &dead)
+        {
+            if (!dead.empty())
+                func->blocks.remove_if([&](IrBasicBlock *bb) { return dead.count(bb) != 0; });
+        }
+
+        void clearBlock(IrBasicBlock *bb)
+        {
+            for (auto *instr : bb->instructions)
+                detachOperands(instr);
+            bb->instructions.clear();
+        }
+
+        // What each phi of `bb` receives along the edge from `from`.
+        std::vector<std::pair<PhiInstr *, IrValue *>> incomingValues(IrBasicBlock *bb, IrBasicBlock *from)
+        {
+            std::vector<std::pair<PhiInstr *, IrValue *>> values;
+            for (auto *instr : bb->instructions)
+            {
+                auto *phi = dynamic_cast<PhiInstr *>(instr);
+                if (!phi)
+                    break;
+                values.emplace_back(phi, phi->getIncomingValue(from));
+            }
+            return values;
+        }
+
+        // IR generation keeps emitting into a block after break/continue.
+        bool dropDeadTails(IrFunction *func)
+        {
+            bool changed = false;
+            for (auto *bb : func->blocks)
+            {
+                auto it = std::find_if(bb->instructions.begin(), bb->instructions.end(), [](Instr *instr)
+                                       { return instr->instrType == InstrType::BR || instr->instrType == InstrType::JUMP ||
+                                                instr->instrType == InstrType::RET; });
+                if (it == bb->instructions.end() || ++it == bb->instructions.end())
+                    continue;
+                for (auto tail = it; tail != bb->instructions.end(); ++tail)
+                    detachOperands(*tail);
+                bb->instructions.erase(it, bb->instructions.end());
+                changed = true;
+            }
+            return changed;
+        }
+
+        bool removeUnreachable(IrFunction *func, Counts &counts)
+        {
+            std::unordered_set<IrBasicBlock *> seen = {func->blocks.front()};
+            std::vector<IrBasicBlock *> work = {func->blocks.front()};
+            while (!work.empty())
+            {
+                IrBasicBlock *bb = work.back();
+                work.pop_back();
+                for (auto *succ : successors(bb))
+                {
+                    if (seen.insert(succ).second)
+                        work.push_back(succ);
+                }
+            }
+            std::unordered_set<IrBasicBlock *> dead;
+            for (auto *bb : func->blocks)
+            {
+                if (!seen.count(bb))
+                    dead.insert(bb);
+            }
+            for (auto *bb : dead)
+            {
+                for (auto *succ : successors(bb))
+                    removePhiIncoming(succ, bb);
+            }
+            for (auto *bb : dead)
+                clearBlock(bb);
+            removeBlocks(func, dead);
+            counts.blocksRemoved += (int)dead.size();
+            return !dead.empty();
+        }
+
+        // br c, X, X  ->  jump X. Phis in X list the edge twice; keep one.
+        bool foldSameTargetBranches(IrFunction *func, Counts &counts)
+        {
+            bool changed = false;
+            for (auto *bb : func->blocks)
+            {
+                Instr *term = terminator(bb);
+                if (!term || term->instrType != InstrType::BR || term->getOperand(1) != term->getOperand(2))
+                    continue;
+                auto *target = static_cast<IrBasicBlock *>(term->getOperand(1));
+                auto incoming = incomingValues(target, bb);
+                removePhiIncoming(target, bb);
+                for (auto &[phi, value] : incoming)
+                    phi->addIncoming(value, bb);
+                detachOperands(term);
+                bb->instructions.pop_back();
+                auto *jump = new JumpInstr(target);
+                jump->parentBlock = bb;
+                bb->instructions.push_back(jump);
+                ++counts.branchesFolded;
+                changed = true;
+            }
+            return changed;
+        }
+
+        // B: jump S, with nothing else in B. Predecessors go straight to S.
+        // When S has phis each predecessor must be new to S and end in a
+        // jump, otherwise the edge would need splitting again in codegen.
+        // One sweep over the function, keeping `preds` up to date.
+        bool bypassForwardingBlocks(IrFunction *func, Counts &counts)
+        {
+            PredMap preds = predecessors(func);
+            std::unordered_set<IrBasicBlock *> removed;
+            std::vector<IrBasicBlock *> blocks(std::next(func->blocks.begin()), func->blocks.end());
+            for (auto *bb : blocks)
+            {
+                if (bb->instructions.size() != 1)
+                    continue;
+                Instr *term = terminator(bb);
+                if (!term || term->instrType != InstrType::JUMP)
+                    continue;
+                auto *succ = static_cast<IrBasicBlock *>(term->getOperand(0));
+                if (succ == bb)
+                    continue;
+                const auto in = preds[bb];
+                auto &succPreds = preds[succ];
+                if (hasPhis(succ))
+                {
+                    bool ok = std::all_of(in.begin(), in.end(), [&](IrBasicBlock *p)
+                                          { return terminator(p)->instrType == InstrType::JUMP &&
+                                                   std::find(succPreds.begin(), succPreds.end(), p) == succPreds.end(); });
+                    if (!ok)
+                        continue;
+                    auto incoming = incomingValues(succ, bb);
+                    removePhiIncoming(succ, bb);
+                    for (auto &[phi, value] : incoming)
+                    {
+                        for (auto *p : in)
+                            phi->addIncoming(value, p);
+                    }
+                }
+                for (auto *p : in)
+                {
+                    Instr *pt = terminator(p);
+                    for (size_t i = 0; i < pt->operandList.size(); ++i)
+                    {
+                        if (pt->getOperand((int)i) == bb)
+                            pt->setOperand((int)i, succ);
+                    }
+                }
+
+                succPreds.erase(std::find(succPreds.begin(), succPreds.end(), bb));
+                for (auto *p : in)
+                {
+                    if (std::find(succPreds.begin(), succPreds.end(), p) == succPreds.end())
+                        succPreds.push_back(p);
+                }
+                preds.erase(bb);
+                clearBlock(bb);
+                removed.insert(bb);
+            }
+            removeBlocks(func, removed);
+            counts.blocksRemoved += (int)removed.size();
+            return !removed.empty();
+        }
+
+        // P: ...; jump B  with B entered only from P: B's body joins P.
+        // One sweep, moving B's outgoing edges over to P in `preds`.
+        bool mergeIntoPredecessor(IrFunction *func, Counts &counts)
+        {
+            PredMap preds = predecessors(func);
+            std::unordered_set<IrBasicBlock *> merged;
+            std::vector<IrBasicBlock *> blocks(std::next(func->blocks.begin()), func->blocks.end());
+            for (auto *bb : blocks)
+            {
+                if (preds[bb].size() != 1)
+                    continue;
+                IrBasicBlock *pred = preds[bb].front();
+                Instr *pt = terminator(pred);
+                if (pred == bb || !pt || pt->instrType != InstrType::JUMP)
+                    continue;
+
+                while (hasPhis(bb))
+                {
+                    Instr *phi = bb->instructions.front();
+                    phi->replaceAllUsesWith(phi->getOperand(0));
+                    detachOperands(phi);
+                    bb->instructions.pop_front();
+                }
+                detachOperands(pt);
+                pred->instructions.pop_back();
+                for (auto *instr : bb->instructions)
+                {
+                    instr->parentBlock = pred;
+                    pred->instructions.push_back(instr);
+                }
+                bb->instructions.clear();
+                for (auto *succ : successors(pred))
+                {
+                    for (auto *instr : succ->instructions)
+                    {
+                        auto *phi = dynamic_cast<PhiInstr *>(instr);
+                        if (!phi)
+                            break;
+                        phi->replaceIncomingBlock(bb, pred);
+                    }
+                    std::replace(preds[succ].begin(), preds[succ].end(), bb, pred);
+                }
+                preds.erase(bb);
+                merged.insert(bb);
+            }
+            removeBlocks(func, merged);
+            counts.blocksMerged += (int)merged.size();
+            return !merged.empty();
+        }
+
+    } // namespace
+
+    void SimplifyCfgPass::run(IrModule *module)
+    {
+        if (!module)
+            return;
+
+        Counts counts;
+        for (auto *func : module->functions)
+        {
+            if (!func || func->isBuiltin || func->blocks.empty())
+                continue;
+            dropDeadTails(func);
+            bool changed = true;
+            while (changed)
+            {
+                changed = removeUnreachable(func, counts);
+                changed |= foldSameTargetBranches(func, counts);
+                changed |= bypassForwardingBlocks(func, counts);
+                changed |= mergeIntoPredecessor(func, counts);
+            }
+        }
+        CompileStats::Record("simplifycfg", "blocks removed: " + std::to_string(counts.blocksRemoved) +
+                                                ", blocks merged: " + std::to_string(counts.blocksMerged) +
+                                                ", branches folded: " + std::to_string(counts.branchesFolded));
+    }
+
+} // namespace optimize
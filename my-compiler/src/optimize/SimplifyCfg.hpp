@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Pass.hpp"
+
+namespace optimize
+{
+
+    // Control-flow cleanup: drops code after a block's first terminator and
+    // blocks unreachable from the entry, turns branches with two equal
+    // targets into jumps, bypasses empty forwarding blocks and merges a
+    // block into its predecessor when that edge is the only way in and out.
+    class SimplifyCfgPass final : public Pass
+    {
+    public:
+        std::string name() const override { return "simplifycfg"; }
+        void run(IrModule *module) override;
+    };
+
+} // namespace optimize
@@ -0,0 +1,170 @@
+#include "Sroa.hpp"
+#include "IrUtils.hpp"
+
+#include "../midend/llvm/IrModule.hpp"
+#include "../midend/llvm/value/IrFunction.hpp"
+#include "../midend/llvm/value/IrBasicBlock.hpp"
+#include "../midend/llvm/value/IrConstantInt.hpp"
+#include "../midend/llvm/type/IrArrayType.hpp"
+#include "../midend/llvm/instr/AllocaInstr.hpp"
+#include "../utils/CompileStats.hpp"
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+namespace optimize
+{
+
+    namespace
+    {
+
+        // Larger arrays would turn into more live values than registers.
+        constexpr int kMaxElements = 16;
+
+        int elementCount(IrType *type)
+        {
+            if (auto *arr = dynamic_cast<IrArrayType *>(type))
+                return arr->numElements * elementCount(arr->elementType);
+            return 1;
+        }
+
+        IrType *scalarType(IrType *type)
+        {
+            while (auto *arr = dynamic_cast<IrArrayType *>(type))
+                type = arr->elementType;
+            return type;
+        }
+
+        // Flat element index of `gep` (alloca, 0, c1, c2, ...) when it
+        // reaches a scalar in bounds, else -1.
+        int flatIndex(Instr *gep, IrType *type)
+        {
+            auto *first = dynamic_cast<IrConstantInt *>(gep->getOperand(1));
+            if (!first || first->value != 0)
+                return -1;
+            int index = 0;
+            for (size_t i = 2; i < gep->operandList.size(); ++i)
+            {
+                auto *arr = dynamic_cast<IrArrayType *>(type);
+                auto *c = dynamic_cast<IrConstantInt *>(gep->getOperand((int)i));
+                if (!arr || !c || c->value < 0 || c->value >= arr->numElements)
+                    return -1;
+                index = index * arr->numElements + c->value;
+                type = arr->elementType;
+            }
+            return type->isArray() ? -1 : index;
+        }
+
+        using Accesses = std::map<int, std::vector<Instr *>>;
+
+        // Records the element `gep` points at (flat index `index`) and
+        // follows pointer arithmetic on it, as left behind when a callee
+        // taking the array was inlined. False if the array must stay whole.
+        bool collect(Instr *gep, int index, int count, Accesses &accesses)
+        {
+            if (index < 0 || index >= count)
+                return false;
+            accesses[index].push_back(gep);
+            for (auto *use : gep->useList)
+            {
+                auto *user = dynamic_cast<Instr *>(use->user);
+                if (!user)
+                    return false;
+                if (user->instrType == InstrType::LOAD)
+                    continue;
+                if (user->instrType == InstrType::STORE && user->getOperand(0) != gep)
+                    continue;
+                if (user->instrType != InstrType::GEP || user->getOperand(0) != gep || user->operandList.size() != 2)
+                    return false;
+                auto *offset = dynamic_cast<IrConstantInt *>(user->getOperand(1));
+                if (!offset || !collect(user, index + offset->value, count, accesses))
+                    return false;
+            }
+            return true;
+        }
+
+        // Element GEPs by flat index, or empty if the array must stay whole.
+        Accesses splitAccesses(AllocaInstr *alloca)
+        {
+            Accesses accesses;
+            int count = elementCount(alloca->allocatedType);
+            for (auto *use : alloca->useList)
+            {
+                auto *gep = dynamic_cast<Instr *>(use->user);
+                if (!gep || gep->instrType != InstrType::GEP || gep->getOperand(0) != alloca ||
+                    gep->operandList.size() < 2)
+                    return {};
+                if (!collect(gep, flatIndex(gep, alloca->allocatedType), count, accesses))
+                    return {};
+            }
+            return accesses;
+        }
+
+    } // namespace
+
+    void SroaPass::run(IrModule *module)
+    {
+        if (!module)
+            return;
+
+        int split = 0, scalars = 0;
+        for (auto *func : module->functions)
+        {
+            if (!func || func->isBuiltin)
+                continue;
+            refreshParentBlocks(func);
+            for (auto *bb : func->blocks)
+            {
+                std::vector<AllocaInstr *> candidates;
+                for (auto *instr : bb->instructions)
+                {
+                    auto *alloca = dynamic_cast<AllocaInstr *>(instr);
+                    if (alloca && alloca->allocatedType->isArray() && elementCount(alloca->allocatedType) <= kMaxElements)
+                        candidates.push_back(alloca);
+                }
+                for (auto *alloca : candidates)
+                {
+                    auto accesses = splitAccesses(alloca);
+                    if (accesses.empty())
+                        continue;
+
+                    auto pos = std::find(bb->instructions.begin(), bb->instructions.end(), alloca);
+                    for (auto &[index, geps] : accesses)
+                    {
+                        auto *slot = new AllocaInstr(scalarType(alloca->allocatedType),
+                                                     alloca->name + "." + std::to_string(index));
+                        slot->parentBlock = bb;
+                        bb->instructions.insert(pos, slot);
+                        // GEPs on GEPs were recorded under their own index;
+                        // only loads and stores are rewired here.
+                        for (auto *gep : geps)
+                        {
+                            std::vector<IrUse *> uses(gep->useList.begin(), gep->useList.end());
+                            for (auto *use : uses)
+                            {
+                                auto *user = static_cast<Instr *>(use->user);
+                                if (user->instrType != InstrType::GEP)
+                                    user->setOperand(user->instrType == InstrType::LOAD ? 0 : 1, slot);
+                            }
+                        }
+                        ++scalars;
+                    }
+                    std::vector<Instr *> dead;
+                    for (auto &[index, geps] : accesses)
+                        dead.insert(dead.end(), geps.begin(), geps.end());
+                    for (auto *gep : dead)
+                    {
+                        detachOperands(gep);
+                        gep->parentBlock->instructions.remove(gep);
+                    }
+                    bb->instructions.erase(pos);
+                    ++split;
+                }
+            }
+        }
+        CompileStats::Record("sroa", "arrays split: " + std::to_string(split) +
+                                         ", scalars created: " + std::to_string(scalars));
+    }
+
+} // namespace optimize
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Pass.hpp"
+
+namespace optimize
+{
+
+    // Scalar replacement of aggregates. A small local array whose every
+    // access is a load or store through a constant-index GEP is split into
+    // one scalar alloca per element used, which mem2reg can then promote.
+    // Arrays indexed dynamically or passed to calls stay in memory.
+    class SroaPass final : public Pass
+    {
+    public:
+        std::string name() const override { return "sroa"; }
+        void run(IrModule *module) override;
+    };
+
+} // namespace optimize
@@ -0,0 +1,375 @@
+#include "StrengthReduce.hpp"
+#include "AliasAnalysis.hpp"
+#include "Dominators.hpp"
+#include "InductionVariables.hpp"
+#include "IrUtils.hpp"
+#include "LoopInfo.hpp"
+
+#include "../midend/llvm/IrModule.hpp"
+#include "../midend/llvm/value/IrFunction.hpp"
+#include "../midend/llvm/value/IrBasicBlock.hpp"
+#include "../midend/llvm/value/IrConstantInt.hpp"
+#include "../midend/llvm/type/IrArrayType.hpp"
+#include "../midend/llvm/type/IrPointerType.hpp"
+#include "../midend/llvm/instr/AluInstr.hpp"
+#include "../midend/llvm/instr/GepInstr.hpp"
+#include "../midend/llvm/instr/IcmpInstr.hpp"
+#include "../midend/llvm/instr/PhiInstr.hpp"
+#include "../utils/CompileStats.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace optimize
+{
+
+    namespace
+    {
+
+        // Each pointer is one more register live across the loop.
+        constexpr int kMaxPointers = 4;
+
+        void insertBeforeTerminator(IrBasicBlock *bb, Instr *instr)
+        {
+            auto pos = std::find(bb->instructions.begin(), bb->instructions.end(), terminator(bb));
+            bb->instructions.insert(pos, instr);
+            instr->parentBlock = bb;
+        }
+
+        // Addresses base[c0][c1]...[iv + offset (+ addend)] share one pointer
+        // per base, constant prefix and loop-invariant addend.
+        struct Access
+        {
+            Instr *gep;
+            int offset;
+        };
+
+        struct PointerGroup
+        {
+            std::vector<IrValue *> prefix; // base and the constant indices
+            IrValue *addend = nullptr;
+            std::vector<Access> accesses;
+            PhiInstr *pointer = nullptr;
+        };
+
+        // Constants are not uniqued, so compare their values.
+        bool samePrefix(const std::vector<IrValue *> &a, const std::vector<IrValue *> &b)
+        {
+            if (a.size() != b.size())
+                return false;
+            for (size_t i = 0; i < a.size(); ++i)
+            {
+                auto *ca = dynamic_cast<IrConstantInt *>(a[i]);
+                auto *cb = dynamic_cast<IrConstantInt *>(b[i]);
+                if (a[i] != b[i] && !(ca && cb && ca->value == cb->value))
+                    return false;
+            }
+            return true;
+        }
+
+        class Reducer
+        {
+        public:
+            Reducer(Loop *loop, const InductionVariable &iv) : loop(loop), iv(iv) {}
+
+            int reduced = 0;
+            bool eliminated = false;
+
+            void run()
+            {
+                collect();
+                for (size_t k = 0; k < groups.size(); ++k)
+                    rewrite(groups[k], (int)k);
+                for (size_t k = 0; k < groups.size() && !eliminated; ++k)
+                    eliminated = replaceExitTest(groups[k]);
+            }
+
+        private:
+            Loop *loop;
+            InductionVariable iv;
+            std::vector<PointerGroup> groups;
+
+            bool isInvariant(IrValue *v) const
+            {
+                auto *instr = dynamic_cast<Instr *>(v);
+                return !instr || !loop->contains(instr->parentBlock);
+            }
+
+            // iv + offset, possibly plus an invariant as in a[i * n + j].
+            bool matchIndex(IrValue *index, int &offset, IrValue *&addend) const
+            {
+                addend = nullptr;
+                if (offsetFrom(index, iv.phi, offset))
+                    return true;
+                auto *add = dynamic_cast<Instr *>(index);
+                if (!add || add->instrType != InstrType::ADD)
+                    return false;
+                for (int i = 0; i < 2; ++i)
+                {
+                    IrValue *other = add->getOperand(1 - i);
+                    if (!dynamic_cast<IrConstantInt *>(other) && isInvariant(other) &&
+                        offsetFrom(add->getOperand(i), iv.phi, offset))
+                    {
+                        addend = other;
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            void collect()
+            {
+                for (auto *bb : loop->blocks)
+                {
+                    for (auto *instr : bb->instructions)
+                    {
+                        if (instr->instrType != InstrType::GEP)
+                            continue;
+                        int offset = 0;
+                        IrValue *addend = nullptr;
+                        size_t last = instr->operandList.size() - 1;
+                        if (last < 1 || !matchIndex(instr->getOperand((int)last), offset, addend))
+                            continue;
+                        bool ok = isInvariant(instr->getOperand(0));
+                        for (size_t i = 1; i < last && ok; ++i)
+                            ok = dynamic_cast<IrConstantInt *>(instr->getOperand((int)i)) != nullptr;
+                        // The pointer steps by the pointee of the GEP's
+                        // result, which must be what the last index scales.
+                        IrType *scaled = static_cast<IrPointerType *>(instr->getOperand(0)->type)->pointedType;
+                        for (size_t i = 2; i <= last && ok; ++i)
+                            scaled = static_cast<IrArrayType *>(scaled)->elementType;
+                        if (!ok || scaled->isArray())
+                            continue;
+                        std::vector<IrValue *> prefix;
+                        for (size_t i = 0; i < last; ++i)
+                            prefix.push_back(instr->getOperand((int)i));
+
+                        auto it = std::find_if(groups.begin(), groups.end(),
+                                               [&](const PointerGroup &g) { return samePrefix(g.prefix, prefix) && g.addend == addend; });
+                        if (it == groups.end())
+                        {
+                            if ((int)groups.size() == kMaxPointers)
+                                continue;
+                            groups.push_back(PointerGroup{prefix, addend, {}, nullptr});
+                            it = std::prev(groups.end());
+                        }
+                        it->accesses.push_back({instr, offset});
+                    }
+                }
+            }
+
+            // &prefix[index + addend], computed in the preheader.
+            Instr *addressIn(const PointerGroup &group, IrValue *index, const std::string &name)
+            {
+                if (group.addend)
+                {
+                    auto *sum = new AluInstr(InstrType::ADD, index, group.addend, name + ".idx");
+                    insertBeforeTerminator(loop->preheader, sum);
+                    index = sum;
+                }
+                std::vector<IrValue *> indices(group.prefix.begin() + 1, group.prefix.end());
+                indices.push_back(index);
+                auto *gep = new GepInstr(group.prefix.front(), indices, name);
+                insertBeforeTerminator(loop->preheader, gep);
+                return gep;
+            }
+
+            void rewrite(PointerGroup &group, int k)
+            {
+                const std::string name = iv.phi->name + ".ptr" + std::to_string(k);
+                Instr *start = addressIn(group, iv.init, name + ".start");
+                auto *pointer = new PhiInstr(start->type, name);
+                pointer->parentBlock = loop->header;
+                loop->header->instructions.push_front(pointer);
+                IrBasicBlock *latch = loop->latches.front();
+                auto *next = new GepInstr(pointer, {IrConstantInt::get(iv.step)}, name + ".next");
+                insertBeforeTerminator(latch, next);
+                pointer->addIncoming(start, loop->preheader);
+                pointer->addIncoming(next, latch);
+                group.pointer = pointer;
+
+                for (auto &access : group.accesses)
+                {
+                    Instr *gep = access.gep;
+                    IrValue *replacement = pointer;
+                    if (access.offset != 0)
+                    {
+                        auto *shifted = new GepInstr(pointer, {IrConstantInt::get(access.offset)}, gep->name);
+                        auto &list = gep->parentBlock->instructions;
+                        list.insert(std::find(list.begin(), list.end(), gep), shifted);
+                        shifted->parentBlock = gep->parentBlock;
+                        replacement = shifted;
+                    }
+                    gep->replaceAllUsesWith(replacement);
+                    detachOperands(gep);
+                    gep->parentBlock->instructions.remove(gep);
+                    ++reduced;
+                }
+            }
+
+            // How many elements the last index of `group` steps over inside
+            // one alloca or global, or -1 when the prefix is not a path
+            // into such an object.
+            long long extent(const PointerGroup &group) const
+            {
+                IrValue *base = group.prefix.front();
+                if (group.addend || !isIdentifiedObject(base))
+                    return -1;
+                IrType *type = static_cast<IrPointerType *>(base->type)->pointedType;
+                if (group.prefix.size() == 1)
+                    return 1;
+                if (static_cast<IrConstantInt *>(group.prefix[1])->value != 0)
+                    return -1;
+                for (size_t i = 2; i < group.prefix.size(); ++i)
+                {
+                    auto *arr = static_cast<IrArrayType *>(type);
+                    int index = static_cast<IrConstantInt *>(group.prefix[i])->value;
+                    if (index < 0 || index >= arr->numElements)
+                        return -1;
+                    type = arr->elementType;
+                }
+                auto *arr = dynamic_cast<IrArrayType *>(type);
+                return arr ? arr->numElements : -1;
+            }
+
+            // Whether the pointer only moves between &prefix[init] and
+            // &prefix[end] (give or take one step) while `iv <cond> end`
+            // holds, with both ends inside the object. Only then do the
+            // addresses order like the indices: &a[n] for an n outside the
+            // array can wrap around the address space.
+            bool staysInObject(const PointerGroup &group, IcmpCond cond, IrValue *bound, int offset) const
+            {
+                long long count = extent(group);
+                auto *init = dynamic_cast<IrConstantInt *>(iv.init);
+                auto *limit = dynamic_cast<IrConstantInt *>(bound);
+                if (count < 0 || !init || !limit)
+                    return false;
+                long long first = init->value;
+                long long end = (long long)limit->value - offset;
+                if (first < 0 || first > count || end < 0 || end > count)
+                    return false;
+                switch (cond)
+                {
+                case IcmpCond::SLT:
+                case IcmpCond::SLE:
+                    return iv.step > 0;
+                case IcmpCond::SGT:
+                case IcmpCond::SGE:
+                    return iv.step < 0;
+                case IcmpCond::NE:
+                    return iv.step == 1 ? first <= end : iv.step == -1 && first >= end;
+                default:
+                    return false;
+                }
+            }
+
+            // iv (+ c) <cond> bound  becomes  ptr <cond> &prefix[bound] (- c),
+            // valid since element sizes are positive and, by staysInObject,
+            // the addresses compared never leave the object. Only done when
+            // the test is all that keeps the index alive.
+            bool replaceExitTest(const PointerGroup &group)
+            {
+                Instr *br = terminator(loop->header);
+                if (!br || br->instrType != InstrType::BR)
+                    return false;
+                auto *cmp = dynamic_cast<IcmpInstr *>(br->getOperand(0));
+                if (!cmp || cmp->parentBlock != loop->header || cmp->useList.size() != 1)
+                    return false;
+
+                int side = -1, offset = 0;
+                Instr *shifted = nullptr;
+                for (int i = 0; i < 2 && side < 0; ++i)
+                {
+                    if (offsetFrom(cmp->getOperand(i), iv.phi, offset) && isInvariant(cmp->getOperand(1 - i)))
+                        side = i;
+                }
+                if (side < 0)
+                    return false;
+                if (cmp->getOperand(side) != iv.phi)
+                {
+                    shifted = static_cast<Instr *>(cmp->getOperand(side));
+                    if (shifted->useList.size() != 1)
+                        return false;
+                }
+
+                // The index, its increment chain and the tested value must
+                // feed nothing else.
+                std::vector<IrValue *> cycle = {iv.phi};
+                for (IrValue *v = iv.next; v != iv.phi;)
+                {
+                    auto *link = static_cast<Instr *>(v);
+                    cycle.push_back(link);
+                    v = dynamic_cast<IrConstantInt *>(link->getOperand(0)) ? link->getOperand(1) : link->getOperand(0);
+                }
+                IrValue *tested = shifted ? shifted : static_cast<IrValue *>(cmp);
+                for (auto *member : cycle)
+                {
+                    for (auto *use : member->useList)
+                    {
+                        bool inCycle = std::find(cycle.begin(), cycle.end(), use->user) != cycle.end();
+                        if (!inCycle && use->user != tested)
+                            return false;
+                    }
+                }
+
+                // bound <cond> iv  reads as  iv <swapped cond> bound.
+                IcmpCond cond = side == 0 ? cmp->cond : swappedCond(cmp->cond);
+                if (!staysInObject(group, cond, cmp->getOperand(1 - side), offset))
+                    return false;
+
+                Instr *end = addressIn(group, cmp->getOperand(1 - side), iv.phi->name + ".end");
+                if (offset != 0)
+                {
+                    auto *adjusted = new GepInstr(end, {IrConstantInt::get(-offset)}, iv.phi->name + ".end.adj");
+                    insertBeforeTerminator(loop->preheader, adjusted);
+                    end = adjusted;
+                }
+                cmp->setOperand(side, group.pointer);
+                cmp->setOperand(1 - side, end);
+                // The index and its increments now only feed each other; DCE
+                // removes the cycle.
+                return true;
+            }
+        };
+
+    } // namespace
+
+    void StrengthReducePass::run(IrModule *module)
+    {
+        if (!module)
+            return;
+
+        int reduced = 0, eliminated = 0;
+        for (auto *func : module->functions)
+        {
+            if (!func || func->isBuiltin || func->blocks.empty())
+                continue;
+            refreshParentBlocks(func);
+
+            auto dt = std::make_unique<DominatorTree>(func);
+            auto loops = std::make_unique<LoopInfo>(func, *dt);
+            if (ensurePreheaders(func, *loops, *dt))
+            {
+                dt = std::make_unique<DominatorTree>(func);
+                loops = std::make_unique<LoopInfo>(func, *dt);
+            }
+
+            // Only straight-line code is added (preheader, header, latch),
+            // so one loop nest serves every loop.
+            for (auto *loop : loops->loops())
+            {
+                for (const auto &iv : findInductionVariables(*loop))
+                {
+                    Reducer reducer(loop, iv);
+                    reducer.run();
+                    reduced += reducer.reduced;
+                    eliminated += reducer.eliminated;
+                }
+            }
+        }
+        CompileStats::Record("ivsr", "addresses reduced: " + std::to_string(reduced) +
+                                         ", indices eliminated: " + std::to_string(eliminated));
+    }
+
+} // namespace optimize
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "Pass.hpp"
+
+namespace optimize
+{
+
+    // Induction-variable strength reduction. Array addresses indexed by a
+    // basic induction variable (plus a constant) are replaced by a pointer
+    // that starts at the first element and advances by the step on the
+    // latch, so each access folds into an `lw off(ptr)`. When the exit test
+    // is then the index's only use, the test compares pointers instead and
+    // the index disappears.
+    class StrengthReducePass final : public Pass
+    {
+    public:
+        std::string name() const override { return "ivsr"; }
+        void run(IrModule *module) override;
+    };
+
+} // namespace optimize
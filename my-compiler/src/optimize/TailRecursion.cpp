@@ -0,0 +1,233 @@
+#include "TailRecursion.hpp"
+#include "AliasAnalysis.hpp"
+#include "IrUtils.hpp"
+
+#include "../midend/llvm/IrModule.hpp"
+#include "../midend/llvm/value/IrFunction.hpp"
+#include "../midend/llvm/value/IrBasicBlock.hpp"
+#include "../midend/llvm/value/IrConstantInt.hpp"
+#include "../midend/llvm/type/IrBaseType.hpp"
+#include "../midend/llvm/instr/AluInstr.hpp"
+#include "../midend/llvm/instr/JumpInstr.hpp"
+#include "../midend/llvm/instr/PhiInstr.hpp"
+#include "../midend/llvm/instr/ReturnInstr.hpp"
+#include "../utils/CompileStats.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+namespace optimize
+{
+
+    namespace
+    {
+
+        struct TailSite
+        {
+            IrBasicBlock *block;
+            Instr *call;
+            Instr *op = nullptr; // the add/mul folded into the accumulator
+
+            // The operand of `op` that is not the call, read at rewrite time
+            // since parameters are replaced by phis in between.
+            IrValue *other() const { return op->getOperand(0) == call ? op->getOperand(1) : op->getOperand(0); }
+        };
+
+        bool isSingleUseBy(Instr *value, Instr *user)
+        {
+            return value->useList.size() == 1 && value->useList.front()->user == user;
+        }
+
+        bool isSelfCall(Instr *instr, IrFunction *func)
+        {
+            return instr->instrType == InstrType::CALL && instr->getOperand(0) == func;
+        }
+
+        // `call; ret call` or `call; op call, x; ret op` at the end of a block.
+        bool matchSite(IrFunction *func, IrBasicBlock *bb, TailSite &site)
+        {
+            Instr *ret = terminator(bb);
+            if (!ret || ret->instrType != InstrType::RET || bb->instructions.size() < 2)
+                return false;
+            auto it = std::prev(bb->instructions.end(), 2);
+            Instr *prev = *it;
+
+            if (isSelfCall(prev, func))
+            {
+                bool returnsIt = ret->operandList.empty() ? prev->type->isVoid()
+                                                           : ret->getOperand(0) == prev && isSingleUseBy(prev, ret);
+                if (!returnsIt)
+                    return false;
+                site = {bb, prev};
+                return true;
+            }
+
+            if ((prev->instrType != InstrType::ADD && prev->instrType != InstrType::MUL) ||
+                ret->operandList.empty() || ret->getOperand(0) != prev || !isSingleUseBy(prev, ret) ||
+                it == bb->instructions.begin())
+                return false;
+            auto *call = *std::prev(it);
+            if (!isSelfCall(call, func) || !isSingleUseBy(call, prev))
+                return false;
+            site = {bb, call, prev};
+            return site.other() != call;
+        }
+
+        // The loop reuses one frame for every iteration, which is only
+        // invisible while no frame object's address leaves the function:
+        // passed to the recursive call, it would alias the next iteration's.
+        bool hasEscapingAlloca(IrFunction *func)
+        {
+            for (auto *bb : func->blocks)
+            {
+                for (auto *instr : bb->instructions)
+                {
+                    if (instr->instrType == InstrType::ALLOCA && addressTaken(instr))
+                        return true;
+                }
+            }
+            return false;
+        }
+
+        bool eliminate(IrFunction *func)
+        {
+            if (hasEscapingAlloca(func))
+                return false;
+            std::vector<TailSite> sites;
+            InstrType accOp = InstrType::ADD;
+            bool accumulates = false;
+            for (auto *bb : func->blocks)
+            {
+                TailSite site;
+                if (!matchSite(func, bb, site))
+                    continue;
+                if (site.op)
+                {
+                    // One accumulator, so one kind of operation.
+                    if (accumulates && site.op->instrType != accOp)
+                        continue;
+                    accumulates = true;
+                    accOp = site.op->instrType;
+                }
+                sites.push_back(site);
+            }
+            if (sites.empty())
+                return false;
+
+            // The old entry becomes the loop header; a fresh entry holds the
+            // frame objects and falls into it.
+            IrBasicBlock *header = func->blocks.front();
+            auto *entry = new IrBasicBlock("tre_entry", func);
+            for (auto it = header->instructions.begin(); it != header->instructions.end();)
+            {
+                Instr *instr = *it;
+                if (instr->instrType != InstrType::ALLOCA)
+                {
+                    ++it;
+                    continue;
+                }
+                it = header->instructions.erase(it);
+                instr->parentBlock = entry;
+                entry->instructions.push_back(instr);
+            }
+            auto *enter = new JumpInstr(header);
+            enter->parentBlock = entry;
+            entry->instructions.push_back(enter);
+            func->blocks.push_front(entry);
+
+            std::vector<PhiInstr *> params;
+            for (auto *param : func->params)
+            {
+                auto *phi = new PhiInstr(param->type, param->name + ".tr");
+                phi->parentBlock = header;
+                param->replaceAllUsesWith(phi);
+                phi->addIncoming(param, entry);
+                params.push_back(phi);
+            }
+            for (auto it = params.rbegin(); it != params.rend(); ++it)
+                header->instructions.push_front(*it);
+
+            PhiInstr *acc = nullptr;
+            if (accumulates)
+            {
+                acc = new PhiInstr(IrBaseType::getInt32(), "%acc.tr");
+                acc->parentBlock = header;
+                acc->addIncoming(IrConstantInt::get(accOp == InstrType::ADD ? 0 : 1), entry);
+                header->instructions.push_front(acc);
+
+                // Returns that are not tail calls finish the pending work.
+                int exits = 0;
+                for (auto *bb : func->blocks)
+                {
+                    Instr *ret = terminator(bb);
+                    if (!ret || ret->instrType != InstrType::RET || ret->operandList.empty())
+                        continue;
+                    bool isSite = false;
+                    for (auto &site : sites)
+                        isSite = isSite || site.block == bb;
+                    if (isSite)
+                        continue;
+                    auto *combined = new AluInstr(accOp, acc, ret->getOperand(0), "%acc.ret" + std::to_string(exits++));
+                    combined->parentBlock = bb;
+                    bb->instructions.insert(std::prev(bb->instructions.end()), combined);
+                    ret->setOperand(0, combined);
+                }
+            }
+
+            for (auto &site : sites)
+            {
+                IrBasicBlock *bb = site.block;
+                for (size_t i = 0; i < params.size(); ++i)
+                    params[i]->addIncoming(site.call->getOperand((int)i + 1), bb);
+
+                Instr *ret = terminator(bb);
+                detachOperands(ret);
+                bb->instructions.remove(ret);
+                if (acc)
+                {
+                    IrValue *next = acc;
+                    if (site.op)
+                    {
+                        auto *step = new AluInstr(accOp, acc, site.other(), site.op->name + ".tr");
+                        step->parentBlock = bb;
+                        bb->instructions.insert(std::find(bb->instructions.begin(), bb->instructions.end(), site.call), step);
+                        next = step;
+                    }
+                    acc->addIncoming(next, bb);
+                }
+                if (site.op)
+                {
+                    detachOperands(site.op);
+                    bb->instructions.remove(site.op);
+                }
+                detachOperands(site.call);
+                bb->instructions.remove(site.call);
+
+                auto *back = new JumpInstr(header);
+                back->parentBlock = bb;
+                bb->instructions.push_back(back);
+            }
+            return true;
+        }
+
+    } // namespace
+
+    void TailRecursionPass::run(IrModule *module)
+    {
+        if (!module)
+            return;
+
+        int count = 0;
+        for (auto *func : module->functions)
+        {
+            if (!func || func->isBuiltin || func->blocks.empty())
+                continue;
+            refreshParentBlocks(func);
+            if (eliminate(func))
+                ++count;
+        }
+        CompileStats::Record("tailrec", "functions turned into loops: " + std::to_string(count));
+    }
+
+} // namespace optimize
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Pass.hpp"
+
+namespace optimize
+{
+
+    // Turns self-calls whose result is returned directly into a jump back to
+    // the top of the function, with phis for the parameters. Returns of the
+    // form `f(...) + x` or `f(...) * x` are handled too by carrying the
+    // pending operation in an accumulator.
+    class TailRecursionPass final : public Pass
+    {
+    public:
+        std::string name() const override { return "tailrec"; }
+        void run(IrModule *module) override;
+    };
+
+} // namespace optimize
@@ -0,0 +1,22 @@
+#include "CompileStats.hpp"
+#include <fstream>
+
+void CompileStats::Record(const std::string &section, const std::string &line) {
+    auto &sections = GetSectionsRef();
+    for (auto &s : sections) {
+        if (s.first == section) {
+            s.second.push_back(line);
+            return;
+        }
+    }
+    sections.push_back({section, {line}});
+}
+
+void CompileStats::Dump(const std::string &outfile) {
+    std::ofstream sf(outfile);
+    if (!sf) return;
+    for (const auto &[name, lines] : GetSectionsRef()) {
+        sf << "[" << name << "]\n";
+        for (const auto &l : lines) sf << l << "\n";
+    }
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <string>
+#include <utility>
+#include <vector>
+
+// Collects human-readable statistics from the compile pipeline (allocator
+// choices, pass counters, ...) and writes them out at the end of a run.
+// Lines are grouped by section; sections keep their first-use order.
+class CompileStats {
+public:
+    static void Record(const std::string &section, const std::string &line);
+    static void Clear() { GetSectionsRef().clear(); }
+    // Write every section as "[section]" followed by its lines.
+    static void Dump(const std::string &outfile = "compile_stats.txt");
+
+private:
+    using Section = std::pair<std::string, std::vector<std::string>>;
+    static std::vector<Section>& GetSectionsRef() {
+        static std::vector<Section> sections;
+        return sections;
+    }
+};